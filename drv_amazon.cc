@@ -14,5 +14,7 @@
 static RegexParser amazon_ena(
 	{ "ena" },
 	RegexParser::total_nomatch(),
-	{ "^queue_(\\d+)_(rx|tx)_(bytes|cnt)$", { 2, 3, 1 } }
+	{ "^queue_(\\d+)_(rx|tx)_(bytes|cnt)$", { 2, 3, 1 } },
+	{ "^(rx|tx)_drops$", 1 },
+	{ "^queue_(\\d+)_(rx|tx)_(?:refil_partial|dma_mapping_err)$", { 2, 1 } }
 );
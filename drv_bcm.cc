@@ -14,23 +14,30 @@
 static RegexParser bnxt_en(
 	{ "bnxt_en" },
 	{ "^(rx|tx)_(bytes|[bum]cast_frames)$", { 1, 2 } },
-	{ "^\\[(\\d+)\\]: (rx|tx)_(bytes|[bum]cast_packets)$", { 2, 3, 1 } }
+	{ "^\\[(\\d+)\\]: (rx|tx)_(bytes|[bum]cast_packets)$", { 2, 3, 1 } },
+	RegexParser::drop_total_nomatch(),
+	{ "^\\[(\\d+)\\]: (rx|tx)_discards$", { 2, 1 } }
 );
 
 static RegexParser bnx2(
 	{ "bnx2" },
 	{ "^(rx|tx)_(bytes|[bum]cast_packets)$", { 1, 2 } },
-	{ "^\\[(\\d+)\\]: (rx|tx)_(bytes|[bum]cast_packets)$", { 2, 3, 1 } }
+	{ "^\\[(\\d+)\\]: (rx|tx)_(bytes|[bum]cast_packets)$", { 2, 3, 1 } },
+	{ "^(rx)_(?:fw_)?discards$", 1 }
 );
 
+// the firmware's and the driver's discards are of different packets,
+// but rx_brb_discard is a port counter, shared by all of its functions
 static RegexParser bnx2x(
 	{ "bnx2x" },
 	{ "^(rx|tx)_(bytes|[bum]cast_packets)$", { 1, 2 } },
-	RegexParser::queue_nomatch()
+	RegexParser::queue_nomatch(),
+	{ "^(rx)_(?:discards|skb_alloc_discard)$", 1 }
 );
 
 static RegexParser tg3(
 	{ "tg3" },
 	{ "^(rx|tx)_(octets|[bum]cast_packets)$", { 1, 2 } },
-	RegexParser::queue_nomatch()
+	RegexParser::queue_nomatch(),
+	{ "^(rx|tx)_discards$", 1 }
 );
@@ -14,5 +14,7 @@
 static RegexParser emulex_be2net (
 	{ "be2net" },
 	RegexParser::total_nomatch(),
-	{ "^(rx|tx)q(\\d+): \\1_(bytes|pkts)$", { 1, 3, 2 } }
+	{ "^(rx|tx)q(\\d+): \\1_(bytes|pkts)$", { 1, 3, 2 } },
+	{ "^(rx)_(?:drops_no_pbuf|drops_no_erx_descr|input_fifo_overflow_drop)$", 1 },
+	{ "^(rx|tx)q(\\d+): \\1_(?:drops_no_skbs|drops_no_frags|drv_drops)$", { 1, 2 } }
 );
@@ -14,5 +14,24 @@
 static RegexParser generic(
 	{ "generic", "r8169", "e1000e" },
 	RegexParser::total_generic(),
-	RegexParser::queue_nomatch()
+	RegexParser::queue_nomatch(),
+	{ "^(rx|tx)_(?:dropped|missed|missed_errors)$", 1 }
+);
+
+// the per-queue stats synthesized from the netdev netlink family
+static RegexParser netdev(
+	{ "netdev" },
+	RegexParser::total_nomatch(),
+	{ "^(rx|tx)_queue_(\\d+)_(bytes|packets)$", { 1, 3, 2 } },
+	RegexParser::drop_total_nomatch(),
+	{ "^(rx)_queue_(\\d+)_hw_drops$", { 1, 2 } }
+);
+
+// the stats synthesized from another ethq's shared memory segment
+static RegexParser shm(
+	{ "shm" },
+	RegexParser::total_generic(),
+	{ "^(rx|tx)_queue_(\\d+)_(bytes|packets)$", { 1, 3, 2 } },
+	RegexParser::drop_total_generic(),
+	{ "^(rx|tx)_queue_(\\d+)_drops$", { 1, 2 } }
 );
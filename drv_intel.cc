@@ -11,26 +11,32 @@
 
 #include "parser.h"
 
+// rx_no_buffer_count counts descriptor shortages, most of which don't
+// lose a packet, whereas rx_missed_errors counts the packets dropped
 static RegexParser intel_generic(
 	{ "ixgbe", "igb" },
 	RegexParser::total_nomatch(),
-	{ "^(rx|tx)_queue_(\\d+)_(bytes|packets)$", { 1, 3, 2 } }
+	{ "^(rx|tx)_queue_(\\d+)_(bytes|packets)$", { 1, 3, 2 } },
+	{ "^(rx)_missed_errors$", 1 }
 );
 
 static RegexParser intel_ice(
 	{ "ice" },
 	{ "^(rx|tx)_(bytes|unicast|broadcast|multicast)$", { 1, 2 } },
-	{ "^(rx|tx)_queue_(\\d+)_(bytes|packets)$", { 1, 3, 2 } }
+	{ "^(rx|tx)_queue_(\\d+)_(bytes|packets)$", { 1, 3, 2 } },
+	RegexParser::drop_total_generic()
 );
 
 static RegexParser intel_i40e(
 	{ "i40e" },
 	RegexParser::total_generic(),
-	{ "^(rx|tx)-(\\d+)\\.(?:\\1_)?(bytes|packets)$", { 1, 3, 2 } }
+	{ "^(rx|tx)-(\\d+)\\.(?:\\1_)?(bytes|packets)$", { 1, 3, 2 } },
+	RegexParser::drop_total_generic()
 );
 
 static RegexParser intel_iavf(
 	{ "iavf" },
 	{ "^(rx|tx)_(bytes|unicast|broadcast|multicast)$", { 1, 2 } },
-	{ "^(rx|tx)-(\\d+)\\.(?:\\1_)?(bytes|packets)$", { 1, 3, 2 } }
+	{ "^(rx|tx)-(\\d+)\\.(?:\\1_)?(bytes|packets)$", { 1, 3, 2 } },
+	{ "^(rx|tx)_discards$", 1 }
 );
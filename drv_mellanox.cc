@@ -14,5 +14,7 @@
 static RegexParser mellanox_mlx5_core( 
 	{ "mlx5_core", "mlx4_en" },
 	RegexParser::total_generic(),
-	{ "^(rx|tx)(\\d+)_(?:0_)?(bytes|packets)$", { 1, 3, 2 } }
+	{ "^(rx|tx)(\\d+)_(?:0_)?(bytes|packets)$", { 1, 3, 2 } },
+	{ "^(rx|tx)_(?:out_of_buffer|queue_dropped|discards_phy)$", 1 },
+	{ "^(rx|tx)(\\d+)_(?:buff_alloc_err|dropped)$", { 1, 2 } }
 );
@@ -14,5 +14,6 @@
 static RegexParser nxp_daap2(
 	{ "fsl_dpaa2_eth" },
 	{ "^\\[hw\\] (rx|tx) (bytes|frames)$", { 1, 2 } },
-	RegexParser::queue_nomatch()
+	RegexParser::queue_nomatch(),
+	{ "^\\[hw\\] (rx|tx) (?:discarded frames|nobuffer discards)$", 1 }
 );
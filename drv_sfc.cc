@@ -14,5 +14,6 @@
 static RegexParser solarflare_sfc(
 	{ "sfc" },
 	{ "^port_(rx|tx)_(bytes|packets)$", { 1, 2 } },
-	{ "^(rx|tx)-(\\d+)\\.(?:\\1)_(bytes|packets)$", { 1, 3, 2 } }
+	{ "^(rx|tx)-(\\d+)\\.(?:\\1)_(bytes|packets)$", { 1, 3, 2 } },
+	{ "^(?:port_)?(rx)_(?:nodesc|noskb)_drops$", 1 }
 );
@@ -14,5 +14,7 @@
 static RegexParser virtio_net(
 	{ "virtio_net" },
 	RegexParser::total_nomatch(),
-	{ "^(rx|tx)_queue_(\\d+)_(bytes|packets)$", { 1, 3, 2 } }
+	{ "^(rx|tx)_queue_(\\d+)_(bytes|packets)$", { 1, 3, 2 } },
+	RegexParser::drop_total_nomatch(),
+	{ "^(rx|tx)_queue_(\\d+)_drops$", { 1, 2 } }
 );
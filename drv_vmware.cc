@@ -14,13 +14,9 @@
 class VMXNet3Parser : public StringsetParser {
 
 private:
-	std::regex	re1;
-	std::regex	re2;
-	std::smatch	ma;
-
-	std::string     ms(size_t n) {
-		return std::ssub_match(ma[n]).str();
-	}
+	Matcher		re1;
+	Matcher		re2;
+	Matcher		re3;
 
 private:
 	size_t		queue = 0;
@@ -28,27 +24,49 @@ private:
 
 public:
 	VMXNet3Parser(const driverlist_t& drivers)
-		: StringsetParser(drivers)
+		: StringsetParser(drivers),
+		  re1("^(Rx|Tx) Queue#$"),
+		  re2("^\\s*[bum]cast (pkts|bytes) (rx|tx)$"),
+		  re3("^\\s*drv dropped (rx|tx) total$")
 	{
-		re1.assign("^(Rx|Tx) Queue#$");
-		re2.assign("^\\s*[bum]cast (pkts|bytes) (rx|tx)$");
 	}
 
 	virtual ~VMXNet3Parser() = default;
 
+	// the queue numbers are in the values
+	bool value_dependent() const {
+		return true;
+	}
+
 	bool match_queue(const std::string& key, size_t value, bool& rx, bool& bytes, size_t& queue) {
 
+		Matcher::captures_t ma;
+
 		// check for match againt queue number
-		if (std::regex_match(key, ma, re1)) {
+		if (re1.match(key, ma)) {
 			this->queue = value;
-			this->rx = (ms(1) == "Rx");
+			this->rx = re1.equal(ma[1], "Rx");
 			return false;
 		}
 
 		// check for data entry
-		bool found = std::regex_match(key, ma, re2);
+		bool found = re2.match(key, ma);
+		if (found) {
+			bytes = re2.equal(ma[1], "bytes");
+			queue = this->queue;
+			rx = this->rx;
+		}
+
+		return found;
+	}
+
+	// the queue is the one whose number was last seen by match_queue()
+	bool match_drop_queue(const std::string& key, size_t value, bool& rx, size_t& queue) {
+
+		Matcher::captures_t ma;
+
+		bool found = re3.match(key, ma);
 		if (found) {
-			bytes = (ms(1) == "bytes");
 			queue = this->queue;
 			rx = this->rx;
 		}
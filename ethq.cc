@@ -10,17 +10,42 @@
  */
 
 #include <iostream>
-#include <sstream>
-#include <iomanip>
 #include <stdexcept>
+#include <exception>
 #include <cstdlib>
+#include <cstdio>
 #include <ctime>
-#include <array>
+#include <algorithm>
+#include <thread>
+#include <csignal>
+#include <map>
+#include <sstream>
 
+#include <fnmatch.h>
 #include <getopt.h>
+#include <net/if.h>
 #include <ncurses.h>
+#include <poll.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
 
+#include "ethtool++.h"
+#include "exporter.h"
 #include "interface.h"
+#include "irqmap.h"
+#include "linkwatch.h"
+#include "output.h"
+#include "publisher.h"
+#include "recorder.h"
+#include "render.h"
+#include "rollup.h"
+#include "sampler.h"
+#include "shm_source.h"
+#include "simulator.h"
+#include "statsmap.h"
+#include "summary.h"
+#include "timing.h"
 #include "util.h"
 
 //
@@ -30,238 +55,771 @@ class EthQApp {
 
 private:	// command line parameters
 	bool			winmode = true;
+	bool			si = false;
+	view_t			view;
+	size_t			count = 0;
+	std::string		command;
 
 private:	// network state
 	std::vector<std::shared_ptr<Interface>>	ifaces;
+	std::unique_ptr<Sampler>		sampler;
+	size_t					nthreads = 0;
+	std::unique_ptr<Recorder>		recorder;
+	std::unique_ptr<StreamOutput>		output;
+	std::unique_ptr<Exporter>		exporter;
+	std::unique_ptr<ShmPublisher>		publisher;
+	std::unique_ptr<Summary>		summary;
+	std::unique_ptr<IrqMap>			irqs;
+	std::unique_ptr<Rollup>			rollup;
+	SelfTiming				timing;
+	bool					timing_summary = false;
+
+	void			refresh();
+
+private:	// interface discovery
+	bool			generic = false;
+	Interface::source_t	from = Interface::ETHTOOL;
+	std::unique_ptr<LinkWatch>		links;
+	std::vector<std::string>		name_filters;
+	std::vector<std::string>		driver_filters;
+	std::map<int, size_t>			attached;	// ifindex -> index in ifaces
+	std::map<int, std::string>		skipped;	// links not to try again
+
+	std::shared_ptr<Interface>	open(const std::string& name, bool discovered = false);
+	bool			wanted(const std::string& name);
+	std::shared_ptr<Interface>	attach(const std::string& name, std::string& why);
+	void			update_links();
+	bool			find_vanished();
+	void			note(const std::string& msg);
+
+private:	// batch runs
+	pid_t			child = -1;
+
+	void			spawn();
+	bool			reap(int& status);
 
 private:	// time handling
 	timespec		now;
 	timespec		interval = { 1, 0 };
-	clockid_t		clock = CLOCK_REALTIME;
-	char			timebuf[9];
+	clockid_t		clock = CLOCK_MONOTONIC;
+	char			timebuf[13];
 
 	void			time_get();
+	void			time_sleep();
 	void			time_wait();
 
 private:	// text mode handling
 	void			textmode_redraw();
 
 private:	// curses mode handling
+	WindowRenderer		window;
+	bool			curses = false;
+	bool			quit = false;
+	bool			show_timing = false;
+
 	void			winmode_redraw();
 	void			winmode_init();
-	bool			winmode_should_exit();
+	void			winmode_wait();
 	void			winmode_exit();
 
 public:
 				EthQApp(int argc, char *argv[]);
 				~EthQApp();
 
-	void			run();
+	int			run();
 };
 
 static void usage(int status = EXIT_SUCCESS)
 {
 	using namespace std;
 
-	cerr << "usage: ethq [-g] [-t] <interface> [interface ...]" << endl;
+	cerr << "usage: ethq [-D] [-g] [-I] [-L] [-n] [-Q] [-t] [-i secs] [-c count | -e cmd] [-j threads] [-G] [-o csv|jsonl] [-l [addr:]port] [-P name] [-C dir] [-r file] [-s] [-O order] [-T n] [-S spec] <interface> [interface ...]" << endl;
+	cerr << "       ethq -a [-d drivers] [options] [pattern ...]" << endl;
+	cerr << "       ethq -A name [options] [interface ...]" << endl;
+	cerr << "  -a, --all : monitor every supported interface whose name matches a pattern, following hotplug" << endl;
+	cerr << "  -A, --attach : show the interfaces that another ethq publishes with -P, instead of reading them" << endl;
+	cerr << "  -c, --count : stop after this many samples and summarise the run" << endl;
+	cerr << "  -C : cache parsed NIC stats maps in this directory" << endl;
+	cerr << "  -D, --timing : show ethq's own sampling and drawing times, and summarise them at exit" << endl;
+	cerr << "  -d, --driver : with -a, only the interfaces with these (comma-separated) drivers" << endl;
+	cerr << "  -e, --exec : run this shell command, sampling until it exits, and summarise the run" << endl;
 	cerr << "  -g : attempt generic driver fallback" << endl;
+	cerr << "  -G, --group : also show the totals for each bond, each NUMA node and the whole host" << endl;
+	cerr << "  -I, --irqs : show each queue's IRQ, CPU and NUMA node, and the IRQ and softirq rates" << endl;
+	cerr << "  -i : sampling interval in seconds (default 1, minimum 0.001)" << endl;
+	cerr << "  -j : sample interfaces concurrently using this many threads" << endl;
+	cerr << "  -l, --listen : serve Prometheus metrics over HTTP (address defaults to 127.0.0.1)" << endl;
+	cerr << "  -L, --link-stats : read totals from the kernel's link stats via rtnetlink (no per-queue stats)" << endl;
+	cerr << "  -Q, --qstats : read per-queue stats via netdev netlink where the driver supports it" << endl;
+	cerr << "  -n : read MAC totals via ethtool netlink (no per-queue stats)" << endl;
+	cerr << "  -O, --sort : show each NIC's queues busiest first by txpps, rxpps, txbps, rxbps, txdrop or rxdrop" << endl;
+	cerr << "  -o : write machine-readable records in CSV or JSON Lines format" << endl;
+	cerr << "  -P, --publish : publish each sample to local readers in this POSIX shared memory segment" << endl;
+	cerr << "  -r, --record : also record the counters to this file" << endl;
+	cerr << "  -s : show rates with SI multipliers (e.g. 1.23M)" << endl;
+	cerr << "  -T, --top : show only this many queues per NIC" << endl;
 	cerr << "  -t : use text mode" << endl;
+	cerr << "  -S, --simulate : add simulated NICs, spec is driver[,key=value...]" << endl;
+	cerr << "       keys: file, count, queues, rate, size, skew, loss, delay, burst=secs/duty/factor" << endl;
 
 	exit(status);
 }
 
-static std::array<size_t, 7> cols = { IFNAMSIZ, 8, 8, 10, 10, 10, 10 };
+void EthQApp::winmode_redraw()
+{
+	char footer[out_max];
+	if (show_timing) {
+		timing.format_status(footer, sizeof footer);
+	}
+
+	window.draw(stdscr, ifaces, timebuf, si, irqs.get(), rollup.get(), show_timing ? footer : nullptr);
+}
+
+void EthQApp::textmode_redraw()
+{
+	render_text(std::cout, ifaces, si, irqs.get(), view, rollup.get());
+}
 
-static std::string out_hdr(const std::array<std::string, cols.size()>& hdrs)
+void EthQApp::time_get()
 {
-	using namespace std;
+	clock_gettime(clock, &now);
+}
 
-	ostringstream out;
-	for (size_t n = 0; n < cols.size(); ++n) {
-		out << setw(cols[n]) << hdrs[n];
-		if (n != cols.size() - 1) {
-			out << " ";
+void EthQApp::time_sleep()
+{
+	while (true) {
+		auto res = clock_nanosleep(clock, TIMER_ABSTIME, &now, nullptr);
+		if (res == 0) {
+			break;
+		} else if (res == EINTR) {
+			continue;
+		} else {
+			errno = res;
+			throw_errno("clock_nanosleep");
 		}
 	}
-
-	return out.str();
 }
 
-static std::string out_data(const std::string& label, const Interface::ifstats_t& stats, const timespec& interval)
+void EthQApp::time_wait()
 {
-	using namespace std;
+	now.tv_nsec += interval.tv_nsec;
+	if (now.tv_nsec >= 1e9) {
+		now.tv_nsec -= 1e9;
+		now.tv_sec += 1;
+	}
+	now.tv_sec += interval.tv_sec;
 
-	ostringstream out;
-	out << setw(cols[0]) << label << " ";
+	// if we've fallen more than a whole interval behind, skip the
+	// missed ticks rather than sampling in a rapid burst to catch up
+	timespec current;
+	clock_gettime(clock, &current);
+	auto behind = (current.tv_sec - now.tv_sec) * 1e9 + (current.tv_nsec - now.tv_nsec);
+	if (behind > interval.tv_sec * 1e9 + interval.tv_nsec) {
+		now = current;
+	}
 
-	auto& q = stats.counts;
-	for (size_t n = 1; n < 5; ++n) {
-		out << setw(cols[n]) << q[n - 1].to_string() << " ";
+	if (winmode) {
+		winmode_wait();
+	} else {
+		time_sleep();
 	}
 
-	for (size_t n = 5; n < 7; ++n) {
-		out << setw(cols[n]) << fixed << setprecision(3);
-		const auto& bps = q[n - 3];
-		if (bps) {
-			auto mbps = static_cast<uint64_t>(bps) * 8 / 1e6;
-			mbps /= (interval.tv_sec + interval.tv_nsec / 1e9);
-			out << mbps;
-		} else {
-			out << "-";
+	auto late = clock_ns(clock) - (now.tv_sec * UINT64_C(1000000000) + now.tv_nsec);
+	timing.woke(static_cast<int64_t>(late) > 0 ? late : 0);
+
+	// the displayed time is wall-clock, with milliseconds shown
+	// for sub-second intervals
+	timespec wall;
+	clock_gettime(CLOCK_REALTIME, &wall);
+	auto len = strftime(timebuf, sizeof timebuf, "%T", gmtime(&wall.tv_sec));
+	if (interval.tv_nsec) {
+		snprintf(timebuf + len, sizeof timebuf - len, ".%03ld", wall.tv_nsec / 1000000);
+	}
+}
+
+//
+// waits for the next tick while watching the keyboard, so that a key
+// that changes the view is acted upon at once rather than at the next
+// sample
+//
+void EthQApp::winmode_wait()
+{
+	while (!quit) {
+		timespec current;
+		clock_gettime(clock, &current);
+		int64_t ns = (now.tv_sec - current.tv_sec) * INT64_C(1000000000) + (now.tv_nsec - current.tv_nsec);
+		if (ns <= 0) {
+			break;
+		}
+
+		timespec timeout = { static_cast<time_t>(ns / 1000000000), static_cast<long>(ns % 1000000000) };
+		pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+		auto res = ::ppoll(&pfd, 1, &timeout, nullptr);
+		if (res < 0 && errno != EINTR) {
+			throw_errno("ppoll");
 		}
-		if (n != cols.size() - 1) {
-			out << " ";
+
+		if (res <= 0) {
+			continue;
+		}
+
+		bool changed = false;
+		bool any = false;
+		int ch;
+		while ((ch = ::getch()) != ERR) {
+			any = true;
+			if (ch == 'q' || ch == 'Q') {
+				quit = true;
+			} else if (ch == 'i') {
+				show_timing = !show_timing;
+				changed = true;
+			} else {
+				changed |= window.key(ch);
+			}
+		}
+
+		if (changed && !quit) {
+			winmode_redraw();
+		}
+
+		// input at EOF stays readable, so just sleep instead
+		if (!any) {
+			time_sleep();
+			break;
 		}
 	}
+}
 
-	return out.str();
+void EthQApp::winmode_init()
+{
+	initscr();
+	curses = true;
+	cbreak();
+	noecho();
+	nonl();
+	nodelay(stdscr, TRUE);
+	intrflush(stdscr, FALSE);
+	keypad(stdscr, TRUE);
+	curs_set(0);
 }
 
-void EthQApp::winmode_redraw()
+void EthQApp::winmode_exit()
 {
-	static auto header = out_hdr({ "NIC", "TX pkts", "RX pkts", "TX bytes", "RX bytes", "TX Mbps", "RX Mbps" });
-	auto w = stdscr;
-
-	// output clamped to screen size
-	auto wstr = [&](const std::string& s, bool pad = false) {
-		auto maxx = getmaxx(w);
-		auto maxy = getmaxy(w);
-		auto curx = getcurx(w);
-		auto cury = getcury(w);
-		if (cury < maxy) {
-			waddnstr(w, s.c_str(), maxx);
-			if (pad) {
-				while (curx++ < maxx) {
-					waddch(w, ' ');
-				}
-			}
-			wmove(w, cury + 1, 0);
-		}
-	};
+	endwin();
+	curses = false;
+}
 
-	// reset screen
-	werase(w);
+//
+// notes can't be shown while curses has the screen - they're written
+// in one go, as interfaces are opened concurrently
+//
+void EthQApp::note(const std::string& msg)
+{
+	if (!curses) {
+		std::cerr << ("ethq: " + msg + "\n") << std::flush;
+	}
+}
 
-	// show time and header
-	wattron(w, A_REVERSE);
-	wstr(header, true);
-	mvwaddstr(w, 0, 2, timebuf);
-	wattroff(w, A_REVERSE);
-	wmove(w, 1, 0);
+static bool glob_match(const std::vector<std::string>& patterns, const std::string& s)
+{
+	if (patterns.empty()) {
+		return true;
+	}
 
-	for (auto& iface: ifaces) {
-		// show totals
-		wattron(w, A_BOLD);
-		wstr(out_data(iface->name(), iface->total_stats(), interval));
-		wattroff(w, A_BOLD);
-
-		// show per-queue data
-		for (size_t i = 0, n = iface->queue_count(); i < n; ++i) {
-			wstr(out_data(std::to_string(i), iface->queue_stats(i), interval));
+	for (const auto& pattern: patterns) {
+		if (fnmatch(pattern.c_str(), s.c_str(), 0) == 0) {
+			return true;
 		}
 	}
+	return false;
+}
 
-	wrefresh(w);
+static const char* source_name(Interface::source_t source)
+{
+	switch (source) {
+		case Interface::NETDEV_NETLINK:
+			return "netdev netlink queue stats";
+		case Interface::ETHTOOL_NETLINK:
+			return "ethtool netlink MAC stats";
+		case Interface::LINK_STATS:
+			return "link stats (totals only)";
+		default:
+			return "ethtool stats";
+	}
 }
 
-void EthQApp::textmode_redraw()
+// a real NIC, as opposed to a bond, bridge, VLAN, veth, tunnel, etc.
+static bool has_device(const std::string& name)
 {
-	static auto header = out_hdr({ "nic", "txp", "rxp", "txb", "rxb", "txmbps", "rxmbps" });
+	return access(("/sys/class/net/" + name + "/device").c_str(), F_OK) == 0;
+}
 
-	std::cout << header << std::endl;
+//
+// an interface whose ethtool stats can't be read or parsed (e.g. a NIC
+// without a parser) falls back to the netdev netlink queue stats if its
+// driver supplies them, and failing that (e.g. a veth or a bridge) to
+// the kernel's link stats for its totals - with -Q the netdev stats
+// are tried first, and the error reported is that of the first choice
+//
+// with -a, a real NIC isn't reduced to its link stats, so that the
+// NICs that aren't supported are skipped (with a note) as before
+//
+std::shared_ptr<Interface> EthQApp::open(const std::string& name, bool discovered)
+{
+	std::vector<Interface::source_t> sources = { from };
+	if (from == Interface::ETHTOOL) {
+		sources.push_back(Interface::NETDEV_NETLINK);
+	} else if (from == Interface::NETDEV_NETLINK) {
+		sources.push_back(Interface::ETHTOOL);
+	}
+	if (from != Interface::LINK_STATS && !(discovered && has_device(name))) {
+		sources.push_back(Interface::LINK_STATS);
+	}
 
-	for (auto& iface: ifaces) {
-		std::cout << out_data(iface->name(), iface->total_stats(), interval);
-		std::cout << std::endl;
-		for (size_t i = 0, n = iface->queue_count(); i < n; ++i) {
-			std::cout << out_data(std::to_string(i), iface->queue_stats(i), interval);
-			std::cout << std::endl;
+	std::exception_ptr first;
+	std::string why;
+	for (auto source: sources) {
+		try {
+			auto iface = std::make_shared<Interface>(name, generic, source);
+			if (first) {
+				note(name + ": using " + source_name(source) + " (" + why + ")");
+			}
+			return iface;
+		} catch (const std::exception& e) {
+			if (!first) {
+				first = std::current_exception();
+				why = e.what();
+			}
 		}
 	}
 
-	std::cout << std::endl;
+	std::rethrow_exception(first);
 }
 
-void EthQApp::time_get()
+bool EthQApp::wanted(const std::string& name)
 {
-	clock_gettime(clock, &now);
+	return glob_match(name_filters, name);
 }
 
-void EthQApp::time_wait()
+//
+// open a discovered interface, or return nullptr if it's filtered out
+// by driver (silently) or can't be monitored (with the reason in `why`)
+//
+std::shared_ptr<Interface> EthQApp::attach(const std::string& name, std::string& why)
 {
-	now.tv_nsec += interval.tv_nsec;
-	if (now.tv_nsec >= 1e9) {
-		now.tv_nsec -= 1e9;
-		now.tv_sec += 1;
+	try {
+		// just the driver info, which is cheap to get
+		if (!driver_filters.empty() && !glob_match(driver_filters, Ethtool(name).driver())) {
+			return nullptr;
+		}
+		return open(name, true);
+	} catch (const std::exception& e) {
+		why = e.what();
+		return nullptr;
 	}
-	now.tv_sec += interval.tv_sec;
+}
 
-	while (true) {
-		auto res = clock_nanosleep(clock, TIMER_ABSTIME, &now, nullptr);
-		if (res == 0) {
-			break;
-		} else if (res == EINTR) {
+//
+// follow the links that have come and gone - a link that comes back
+// under a name that was seen before takes over that name's place, so
+// its position in the display and its exported totals carry on where
+// they left off
+//
+void EthQApp::update_links()
+{
+	auto& current = links->links();
+
+	// the sampler's threads mustn't see the interfaces change under them
+	bool threaded = static_cast<bool>(sampler);
+	sampler.reset();
+
+	for (auto iter = attached.begin(); iter != attached.end(); ) {
+		auto link = current.find(iter->first);
+		auto& iface = ifaces[iter->second];
+		if (link == current.end() || link->second != iface->name() || skipped.count(iter->first)) {
+			iface->detach();
+			iter = attached.erase(iter);
+		} else {
+			++iter;
+		}
+	}
+
+	// try again with links that have been renamed, or whose index is reused
+	for (auto iter = skipped.begin(); iter != skipped.end(); ) {
+		auto link = current.find(iter->first);
+		if (link == current.end() || link->second != iter->second) {
+			iter = skipped.erase(iter);
+		} else {
+			++iter;
+		}
+	}
+
+	for (const auto& link: current) {
+		if (attached.count(link.first) || skipped.count(link.first)) continue;
+		skipped[link.first] = link.second;
+		if (!wanted(link.second)) continue;
+
+		std::string why;
+		auto iface = attach(link.second, why);
+		if (!iface) {
+			if (!why.empty()) note("skipping " + link.second + ": " + why);
 			continue;
+		}
+
+		size_t slot = 0;
+		while (slot < ifaces.size() && !(ifaces[slot]->detached() && ifaces[slot]->name() == link.second)) {
+			++slot;
+		}
+		if (slot == ifaces.size()) {
+			ifaces.emplace_back();
+		}
+
+		ifaces[slot] = iface;
+		attached[link.first] = slot;
+		skipped.erase(link.first);
+	}
+
+	if (threaded) {
+		sampler.reset(new Sampler(ifaces, std::min(nthreads, ifaces.size())));
+	}
+
+	if (irqs) {
+		irqs.reset(new IrqMap(ifaces));
+	}
+
+	if (rollup) {
+		rollup.reset(new Rollup(ifaces));
+	}
+}
+
+//
+// a NIC can fail to read because it's gone before its link event has
+// arrived, in which case it's marked so that update_links() drops it
+//
+bool EthQApp::find_vanished()
+{
+	bool found = false;
+	for (const auto& link: attached) {
+		auto& name = ifaces[link.second]->name();
+		if (if_nametoindex(name.c_str()) != static_cast<unsigned>(link.first)) {
+			skipped[link.first] = name;
+			found = true;
+		}
+	}
+	return found;
+}
+
+//
+// with worker threads, the display waits at most half an interval
+// for the samples - any NIC that's slower than that keeps showing
+// its previous results until its refresh is complete
+//
+void EthQApp::refresh()
+{
+	uint64_t tick = now.tv_sec * UINT64_C(1000000000) + now.tv_nsec;
+
+	if (links && links->poll()) {
+		update_links();
+	}
+
+	auto start = clock_ns();
+
+	try {
+		if (sampler) {
+			uint64_t span = interval.tv_sec * UINT64_C(1000000000) + interval.tv_nsec;
+			sampler->refresh(tick + span / 2);
 		} else {
-			errno = res;
-			throw_errno("clock_nanosleep");
+			for (auto& iface: ifaces) {
+				iface->refresh();
+			}
+		}
+	} catch (...) {
+		if (!links || !find_vanished()) {
+			throw;
 		}
+		update_links();
+	}
+
+	for (auto& iface: ifaces) {
+		iface->acquire();
+	}
+
+	timing.sampled(clock_ns() - start);
+	timing.update(ifaces);
+
+	if (irqs) {
+		irqs->refresh();
+	}
+
+	if (rollup) {
+		rollup->refresh();
+	}
+
+	if (recorder) {
+		recorder->append(tick);
+	}
+
+	if (publisher) {
+		publisher->update(tick);
 	}
-	strftime(timebuf, sizeof timebuf, "%T", gmtime(&now.tv_sec));
 }
 
-bool EthQApp::winmode_should_exit()
+//
+// batch runs end on SIGINT or SIGTERM at the next tick, so that the
+// summary is still written (and a published segment is removed)
+//
+static volatile sig_atomic_t stopping = 0;
+
+static void stop(int)
 {
-	auto ch = ::getch();
-	return (ch == 'q' || ch == 'Q');
+	stopping = 1;
 }
 
-void EthQApp::winmode_init()
+//
+// the command runs in its own process group, so that the whole of it
+// can be stopped if the run is cut short
+//
+void EthQApp::spawn()
 {
-	initscr();
-	cbreak();
-	noecho();
-	nonl();
-	nodelay(stdscr, TRUE);
-	intrflush(stdscr, FALSE);
-	keypad(stdscr, TRUE);
-	curs_set(0);
+	const char* args[] = { "sh", "-c", command.c_str(), nullptr };
+
+	posix_spawnattr_t attr;
+	posix_spawnattr_init(&attr);
+	posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+	posix_spawnattr_setpgroup(&attr, 0);
+
+	auto res = posix_spawn(&child, "/bin/sh", nullptr, &attr, const_cast<char**>(args), environ);
+	posix_spawnattr_destroy(&attr);
+	if (res) {
+		errno = res;
+		throw_errno("posix_spawn");
+	}
 }
 
-void EthQApp::winmode_exit()
+// true if the command has exited, with `status` set to its exit status
+bool EthQApp::reap(int& status)
 {
-	endwin();
+	int wstatus;
+	auto res = waitpid(child, &wstatus, WNOHANG);
+	if (res <= 0) {
+		return false;
+	}
+
+	child = -1;
+	status = WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) : 128 + WTERMSIG(wstatus);
+	return true;
 }
 
-void EthQApp::run()
+int EthQApp::run()
 {
+	int status = EXIT_SUCCESS;
+	size_t samples = 0;
+
+	if (summary || timing_summary || publisher) {
+		struct sigaction sa = { };
+		sa.sa_handler = stop;
+		sigaction(SIGINT, &sa, nullptr);
+		sigaction(SIGTERM, &sa, nullptr);
+	}
+
+	if (!command.empty()) {
+		spawn();
+	}
+
 	time_get();
 
-	while (true) {
-		if (winmode && winmode_should_exit()) break;
+	while (!stopping) {
 		time_wait();
-		for (auto& iface: ifaces) {
-			iface->refresh();
+		if (quit) break;
+		refresh();
+
+		if (exporter) {
+			exporter->update();
 		}
 
+		auto start = clock_ns();
 		if (winmode) {
 			winmode_redraw();
-		} else {
+		} else if (output) {
+			output->write(ifaces);
+		} else if (!exporter) {
 			textmode_redraw();
 		}
+		timing.drawn(clock_ns() - start);
+
+		if (summary) {
+			summary->update(ifaces);
+			if (++samples == count || (child > 0 && reap(status))) break;
+		}
+	}
+
+	// don't leave the command running if the run was cut short
+	if (child > 0) {
+		kill(-child, SIGTERM);
+		waitpid(child, nullptr, 0);
+		child = -1;
+	}
+
+	if (summary) {
+		if (winmode) {
+			winmode_exit();
+			winmode = false;
+		}
+		summary->write(output ? std::cerr : std::cout, ifaces, si);
+	}
+
+	if (timing_summary) {
+		if (winmode) {
+			winmode_exit();
+			winmode = false;
+		}
+		timing.write(std::cerr);
 	}
+
+	return status;
 }
 
 EthQApp::EthQApp(int argc, char *argv[])
 {
 	int opt;
-	bool generic = false;
+	bool all = false;
+	bool show_irqs = false;
+	bool group = false;
+	std::string record;
+	std::string listen;
+	std::string publish;
+	bool stream = false;
+	auto format = StreamOutput::CSV;
+	std::string segment;
+	std::vector<std::shared_ptr<const Simulator::Model>> sims;
+
+	static const option long_options[] = {
+		{ "all", no_argument, nullptr, 'a' },
+		{ "attach", required_argument, nullptr, 'A' },
+		{ "count", required_argument, nullptr, 'c' },
+		{ "driver", required_argument, nullptr, 'd' },
+		{ "timing", no_argument, nullptr, 'D' },
+		{ "exec", required_argument, nullptr, 'e' },
+		{ "group", no_argument, nullptr, 'G' },
+		{ "irqs", no_argument, nullptr, 'I' },
+		{ "link-stats", no_argument, nullptr, 'L' },
+		{ "listen", required_argument, nullptr, 'l' },
+		{ "publish", required_argument, nullptr, 'P' },
+		{ "qstats", no_argument, nullptr, 'Q' },
+		{ "record", required_argument, nullptr, 'r' },
+		{ "simulate", required_argument, nullptr, 'S' },
+		{ "sort", required_argument, nullptr, 'O' },
+		{ "top", required_argument, nullptr, 'T' },
+		{ nullptr, 0, nullptr, 0 }
+	};
 
-	while ((opt = getopt(argc, argv, "ght")) != -1) {
+	while ((opt = getopt_long(argc, argv, "aA:c:C:d:De:gGhIi:j:l:LnO:o:P:Qr:sS:T:t", long_options, nullptr)) != -1) {
 		switch (opt) {
+			case 'a':
+				all = true;
+				break;
+			case 'A':
+				segment = optarg;
+				break;
+			case 'c': {
+				char *end;
+				count = strtoul(optarg, &end, 10);
+				if (*end || count == 0) {
+					usage(EXIT_FAILURE);
+				}
+				break;
+			}
+			case 'C':
+				StatsMap::set_cache_dir(optarg);
+				break;
+			case 'd': {
+				std::istringstream in(optarg);
+				std::string driver;
+				while (std::getline(in, driver, ',')) {
+					if (!driver.empty()) driver_filters.push_back(driver);
+				}
+				break;
+			}
+			case 'D':
+				timing_summary = true;
+				show_timing = true;
+				break;
+			case 'e':
+				command = optarg;
+				break;
 			case 'g':
 				generic = true;
 				break;
+			case 'G':
+				group = true;
+				break;
+			case 'I':
+				show_irqs = true;
+				break;
+			case 'i': {
+				char *end;
+				auto secs = strtod(optarg, &end);
+				if (*end || !(secs >= 0.001)) {
+					usage(EXIT_FAILURE);
+				}
+				auto ns = static_cast<uint64_t>(secs * 1e9 + 0.5);
+				interval.tv_sec = ns / 1000000000;
+				interval.tv_nsec = ns % 1000000000;
+				break;
+			}
+			case 'j': {
+				char *end;
+				auto n = strtol(optarg, &end, 10);
+				if (*end || n < 1) {
+					usage(EXIT_FAILURE);
+				}
+				nthreads = n;
+				break;
+			}
+			case 'l':
+				listen = optarg;
+				winmode = false;
+				break;
+			case 'L':
+				from = Interface::LINK_STATS;
+				break;
+			case 'n':
+				from = Interface::ETHTOOL_NETLINK;
+				break;
+			case 'O':
+				view.sort = view_t::parse_sort(optarg);
+				break;
+			case 'o':
+				stream = true;
+				format = StreamOutput::parse(optarg);
+				winmode = false;
+				break;
+			case 'P':
+				publish = optarg;
+				break;
+			case 'Q':
+				from = Interface::NETDEV_NETLINK;
+				break;
+			case 'r':
+				record = optarg;
+				break;
+			case 's':
+				si = true;
+				break;
+			case 'S': {
+				auto config = Simulator::config_t::parse(optarg);
+				auto model = Simulator::build(config);
+				sims.insert(sims.end(), config.count, model);
+				break;
+			}
+			case 'T': {
+				char *end;
+				view.top = strtoul(optarg, &end, 10);
+				if (*end || view.top == 0) {
+					usage(EXIT_FAILURE);
+				}
+				break;
+			}
 			case 't':
 				winmode = false;
 				break;
@@ -272,17 +830,119 @@ EthQApp::EthQApp(int argc, char *argv[])
 		}
 	}
 
-	// connect to the interface(s)
-	while (optind < argc) {
-		ifaces.emplace_back(std::make_shared<Interface>(argv[optind++], generic));
+	//
+	// with -a the arguments are patterns for the names of the links to
+	// be discovered, and any that can't be monitored are just noted
+	//
+	std::vector<std::string> names(argv + optind, argv + argc);
+	std::vector<int> indexes;
+
+	if (all) {
+		name_filters.swap(names);
+		links.reset(new LinkWatch());
+		for (const auto& link: links->links()) {
+			skipped[link.first] = link.second;
+			if (wanted(link.second)) {
+				indexes.push_back(link.first);
+				names.push_back(link.second);
+			}
+		}
+	} else if (!driver_filters.empty()) {
+		usage(EXIT_FAILURE);
+	}
+
+	// with -A the interfaces are the published ones, by default all of them
+	if (!segment.empty()) {
+		if (all) {
+			usage(EXIT_FAILURE);
+		}
+		if (names.empty()) {
+			names = ShmSource::list(segment);
+		}
 	}
 
-	if (ifaces.size() == 0) {
+	//
+	// connect to the interface(s) - this is done in parallel since
+	// each NIC needs several ioctls, some of which may be slow
+	//
+	auto init_threads = nthreads ? nthreads : std::max(1U, std::thread::hardware_concurrency());
+	std::vector<std::string> errors(names.size());
+
+	ifaces.resize(names.size() + sims.size());
+	parallel_for(ifaces.size(), init_threads, [&](size_t i) {
+		if (i >= names.size()) {
+			auto n = i - names.size();
+			auto source = new Simulator(sims[n], n);
+			ifaces[i] = std::make_shared<Interface>("sim" + std::to_string(n), source, generic);
+		} else if (!segment.empty()) {
+			auto source = new ShmSource(segment, names[i]);
+			ifaces[i] = std::make_shared<Interface>(names[i], source, generic);
+		} else if (all) {
+			ifaces[i] = attach(names[i], errors[i]);
+		} else {
+			ifaces[i] = open(names[i]);
+		}
+	});
+
+	// drop the discovered links that weren't attached
+	if (all) {
+		size_t slot = 0;
+		for (size_t i = 0; i < ifaces.size(); ++i) {
+			if (i < names.size() && !ifaces[i]) {
+				if (!errors[i].empty()) note("skipping " + names[i] + ": " + errors[i]);
+				continue;
+			}
+			if (i < names.size()) {
+				attached[indexes[i]] = slot;
+				skipped.erase(indexes[i]);
+			}
+			ifaces[slot++] = ifaces[i];
+		}
+		ifaces.resize(slot);
+	}
+
+	if (ifaces.size() == 0 && !all) {
 		usage(EXIT_FAILURE);
 	}
 
+	if (nthreads > 0) {
+		sampler.reset(new Sampler(ifaces, std::min(nthreads, ifaces.size())));
+	}
+
+	if (!record.empty()) {
+		uint64_t ns = interval.tv_sec * UINT64_C(1000000000) + interval.tv_nsec;
+		recorder.reset(new Recorder(record, ifaces, ns));
+	}
+
+	if (show_irqs) {
+		irqs.reset(new IrqMap(ifaces));
+	}
+
+	if (group) {
+		rollup.reset(new Rollup(ifaces));
+	}
+
+	if (count || !command.empty()) {
+		summary.reset(new Summary());
+	}
+
+	if (!listen.empty()) {
+		exporter.reset(new Exporter(listen, ifaces));
+	}
+
+	// not until now, as this writes the CSV header
+	if (stream) {
+		output.reset(new StreamOutput(format));
+	}
+
+	if (!publish.empty()) {
+		uint64_t ns = interval.tv_sec * UINT64_C(1000000000) + interval.tv_nsec;
+		publisher.reset(new ShmPublisher(publish, ifaces, ns));
+	}
+
 	// set up display mode
 	if (winmode) {
+		window.view = view;
 		winmode_init();
 	}
 }
@@ -301,7 +961,7 @@ int main(int argc, char *argv[])
 
 	try {
 		EthQApp app(argc, argv);
-		app.run();
+		res = app.run();
 	} catch (const std::exception& e) {
 		std::cerr << "error: " << e.what() << std::endl;
 		res = EXIT_FAILURE;
@@ -0,0 +1,346 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <streambuf>
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <dirent.h>
+#include <getopt.h>
+#include <ncurses.h>
+
+#include "interface.h"
+#include "matcher.h"
+#include "parser.h"
+#include "render.h"
+#include "simulator.h"
+#include "util.h"
+
+//
+// microbenchmarks for ethq's hot paths - the stats string parsers,
+// Interface::refresh() and the display formatting
+//
+// each benchmark is run for enough iterations to take at least the
+// minimum time, several times over, and the median time per operation
+// is reported along with the number of heap allocations per operation
+// (as counted by operator new, so allocations made inside ncurses
+// aren't included)
+//
+// run from the top of the source tree, since the test data in tests/
+// is used both directly and as the basis for simulated NICs
+//
+
+static std::atomic<uint64_t> allocs { 0 };
+
+void* operator new(size_t n)
+{
+	allocs.fetch_add(1, std::memory_order_relaxed);
+	auto p = malloc(n ? n : 1);
+	if (!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+static double min_time = 0.1;		// seconds per run
+static size_t reps = 5;
+static std::string only;
+
+template<class F>
+static void bench(const std::string& name, F fn)
+{
+	if (!only.empty() && name.find(only) == std::string::npos) {
+		return;
+	}
+
+	// find how many iterations it takes to fill a run
+	uint64_t min_ns = min_time * 1e9;
+	size_t n = 1;
+	while (true) {
+		auto start = clock_ns();
+		for (size_t i = 0; i < n; ++i) fn();
+		auto ns = clock_ns() - start;
+		if (ns >= min_ns) break;
+		n = std::max(n * 2, static_cast<size_t>(n * 1.2 * min_ns / (ns + 1)));
+	}
+
+	std::vector<double> times;
+	uint64_t count = 0;
+
+	for (size_t r = 0; r < reps; ++r) {
+		auto before = allocs.load();
+		auto start = clock_ns();
+		for (size_t i = 0; i < n; ++i) fn();
+		times.push_back(static_cast<double>(clock_ns() - start) / n);
+		count += allocs.load() - before;
+	}
+
+	std::sort(times.begin(), times.end());
+	printf("%-32s %12zu %12.1f %10.2f\n", name.c_str(), n,
+		times[times.size() / 2], static_cast<double>(count) / (n * reps));
+	fflush(stdout);
+}
+
+//
+// the stats names and values from one of the tests/ files
+//
+struct testdata_t {
+	std::vector<std::string>	names;
+	std::vector<uint64_t>		values;
+};
+
+static testdata_t load(const std::string& path)
+{
+	std::ifstream in(path);
+	if (!in) {
+		throw std::runtime_error("can't read " + path);
+	}
+
+	testdata_t data;
+	Matcher re("^\\s*(.*?): (\\d+)$");
+	Matcher::captures_t caps;
+	std::string line;
+
+	while (std::getline(in, line)) {
+		if (re.match(line, caps)) {
+			data.names.push_back(caps[1].str());
+			data.values.push_back(std::stoull(caps[2].str()));
+		}
+	}
+
+	return data;
+}
+
+static void bench_parsers()
+{
+	auto dir = opendir("tests");
+	if (!dir) {
+		throw_errno("opendir(tests)");
+	}
+
+	std::vector<std::string> files;
+	while (auto ent = readdir(dir)) {
+		if (ent->d_name[0] != '.') {
+			files.push_back(ent->d_name);
+		}
+	}
+	closedir(dir);
+	std::sort(files.begin(), files.end());
+
+	for (const auto& file: files) {
+		// files for particular driver versions are named driver-version
+		auto driver = file.substr(0, file.find('-'));
+		auto parser = StringsetParser::find(driver);
+		if (!parser) continue;
+
+		auto data = load("tests/" + file);
+
+		// one op is a pass over all of the NIC's stats
+		bench("parse/" + file, [&]() {
+			bool rx, bytes;
+			size_t queue;
+			for (size_t i = 0, n = data.names.size(); i < n; ++i) {
+				parser->match_total(data.names[i], data.values[i], rx, bytes);
+				parser->match_queue(data.names[i], data.values[i], rx, bytes, queue);
+			}
+		});
+	}
+}
+
+//
+// replays two fixed snapshots of a simulated NIC, alternately, so
+// that refresh() measures just the copy and the delta accumulation
+//
+class Replay : public StatsSource {
+
+private:
+	stringset_t		names;
+	std::vector<__u64>	values[2];
+	size_t			next = 0;
+
+public:
+	Replay(size_t queues) {
+		Simulator::config_t config;
+		config.driver = "mlx5_core";
+		config.file = "tests/mlx5_core";
+		config.queues = queues;
+
+		Simulator sim(Simulator::build(config), 0);
+		names = sim.stringset(ETH_SS_STATS);
+
+		snapshot_t snap;
+		sim.stats(snap);
+		values[0].assign(snap.data(), snap.data() + snap.size());
+		values[1] = values[0];
+		for (size_t i = 0; i < values[1].size(); ++i) {
+			values[1][i] += 1000 + i;
+		}
+	}
+
+	stringset_t		stringset(ethtool_stringset ss)	{ return names; };
+	std::string		driver()			{ return "mlx5_core"; };
+	std::string		version()			{ return "replay"; };
+
+	void stats(snapshot_t& snap) {
+		auto& v = values[next ^= 1];
+		snap.resize(v.size());
+		memcpy(snap.data(), v.data(), v.size() * sizeof(__u64));
+	}
+};
+
+// a stream that discards its output
+class NullBuf : public std::streambuf {
+protected:
+	int_type		overflow(int_type c)			{ return c; };
+	std::streamsize		xsputn(const char*, std::streamsize n)	{ return n; };
+};
+
+static ifaces_t make_ifaces(size_t count, size_t queues)
+{
+	ifaces_t ifaces;
+	for (size_t i = 0; i < count; ++i) {
+		auto name = "bench" + std::to_string(i);
+		ifaces.emplace_back(std::make_shared<Interface>(name, new Replay(queues)));
+		ifaces.back()->refresh();
+		ifaces.back()->acquire();
+	}
+	return ifaces;
+}
+
+static void bench_refresh()
+{
+	for (auto queues: { 1, 8, 32, 128 }) {
+		auto iface = make_ifaces(1, queues)[0];
+		bench("refresh/" + std::to_string(queues) + "q", [&]() {
+			iface->refresh();
+		});
+	}
+}
+
+static void bench_render()
+{
+	auto ifaces = make_ifaces(4, 32);
+	auto& stats = ifaces[0]->queue_stats(0);
+
+	char line[out_max];
+	bench("format/row", [&]() {
+		format_row(line, "0", 1, stats, 1.0, false);
+	});
+
+	bench("format/row-si", [&]() {
+		format_row(line, "0", 1, stats, 1.0, true);
+	});
+
+	NullBuf buf;
+	std::ostream null(&buf);
+	bench("render/text/4x32q", [&]() {
+		render_text(null, ifaces);
+	});
+
+	//
+	// the window is drawn into a terminal that's big enough to show
+	// every row, with the output discarded
+	//
+	setenv("TERM", "xterm", 0);
+	setenv("LINES", "200", 1);
+	setenv("COLUMNS", "100", 1);
+
+	auto out = fopen("/dev/null", "w");
+	auto in = fopen("/dev/null", "r");
+	auto screen = newterm(nullptr, out, in);
+	if (!screen) {
+		throw std::runtime_error("newterm failed");
+	}
+
+	//
+	// the replayed counters alternate, so every other frame changes
+	// - "static" has the same rates every frame
+	//
+	char timebuf[] = "00:00:00";
+	WindowRenderer window;
+	bench("render/window/4x32q", [&]() {
+		for (auto& iface: ifaces) {
+			iface->refresh();
+			iface->acquire();
+		}
+		window.draw(stdscr, ifaces, timebuf);
+	});
+
+	bench("render/window-static/4x32q", [&]() {
+		window.draw(stdscr, ifaces, timebuf);
+	});
+
+	endwin();
+	delscreen(screen);
+	fclose(out);
+	fclose(in);
+}
+
+static void usage(int status = EXIT_SUCCESS)
+{
+	using namespace std;
+
+	cerr << "usage: ethq_bench [-t secs] [-r reps] [filter]" << endl;
+	cerr << "  -t : minimum time for each run (default 0.1)" << endl;
+	cerr << "  -r : number of timed runs, the median is shown (default 5)" << endl;
+
+	exit(status);
+}
+
+int main(int argc, char *argv[])
+{
+	int opt;
+
+	while ((opt = getopt(argc, argv, "hr:t:")) != -1) {
+		switch (opt) {
+			case 'r':
+				reps = std::max(atoi(optarg), 1);
+				break;
+			case 't':
+				min_time = atof(optarg);
+				break;
+			case 'h':
+				usage();
+			default:
+				usage(EXIT_FAILURE);
+		}
+	}
+
+	if (optind < argc - 1) {
+		usage(EXIT_FAILURE);
+	} else if (optind == argc - 1) {
+		only = argv[optind];
+	}
+
+	try {
+		printf("%-32s %12s %12s %10s\n", "benchmark", "iterations", "ns/op", "allocs/op");
+		bench_parsers();
+		bench_refresh();
+		bench_render();
+	} catch (const std::exception& e) {
+		std::cerr << "error: " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+
+#include <getopt.h>
+
+#include "recording.h"
+#include "util.h"
+
+//
+// summarises an `ethq --record` file - the mean and peak per-second
+// rates of each NIC and queue, optionally restricted to part of the
+// recording, with the peaks taken over windows of a given length
+//
+
+static void usage(int status = EXIT_SUCCESS)
+{
+	using namespace std;
+
+	cerr << "usage: ethq_report [-s secs] [-d secs] [-w secs] <file>" << endl;
+	cerr << "  -s : skip this many seconds from the start of the recording" << endl;
+	cerr << "  -d : only report on this many seconds" << endl;
+	cerr << "  -w : measure peak rates over windows of at least this many seconds" << endl;
+	cerr << "       (default: between consecutive samples)" << endl;
+
+	exit(status);
+}
+
+static double seconds(const char* arg)
+{
+	char *end;
+	auto secs = strtod(arg, &end);
+	if (*end || !(secs >= 0)) {
+		usage(EXIT_FAILURE);
+	}
+	return secs;
+}
+
+static std::string wall_time(const Recording& rec, uint64_t ns)
+{
+	time_t t = (ns + rec.epoch()) / 1000000000;
+	char buf[32];
+	strftime(buf, sizeof buf, "%F %T", gmtime(&t));
+	return buf;
+}
+
+//
+// per-second rates for each of the four counters, as displayed by
+// ethq - packets, then Mbps
+//
+typedef std::array<double, 4> rates_t;
+
+static rates_t rates(const uint64_t* a, const uint64_t* b, uint64_t ns)
+{
+	rates_t r;
+	for (size_t i = 0; i < 4; ++i) {
+		r[i] = (b[i] - a[i]) * 1e9 / ns;
+		if (i >= 2) {
+			r[i] = r[i] * 8 / 1e6;
+		}
+	}
+	return r;
+}
+
+static std::array<size_t, 5> cols = { 16, 12, 12, 10, 10 };
+
+static void out_hdr(std::ostream& out)
+{
+	static const char* hdrs[] = { "NIC", "TX pkts", "RX pkts", "TX Mbps", "RX Mbps" };
+
+	for (size_t n = 0; n < cols.size(); ++n) {
+		out << std::setw(cols[n]) << hdrs[n] << (n + 1 < cols.size() ? " " : "\n");
+	}
+}
+
+static void out_data(std::ostream& out, const std::string& label, const rates_t& r, uint32_t present)
+{
+	// displayed in tx pkts, rx pkts, tx bytes, rx bytes order
+	out << std::setw(cols[0]) << label;
+	for (size_t i = 0; i < 4; ++i) {
+		out << " " << std::setw(cols[i + 1]);
+		if (present & (1U << i)) {
+			if (i < 2) {
+				out << std::fixed << std::setprecision(0) << r[i];
+			} else {
+				out << std::fixed << std::setprecision(3) << r[i];
+			}
+		} else {
+			out << "-";
+		}
+	}
+	out << "\n";
+}
+
+static void report(const Recording& rec, double skip, double duration, double window)
+{
+	auto count = rec.count();
+	if (count == 0) {
+		throw std::runtime_error("recording is empty");
+	}
+
+	// select the records in the requested part of the recording
+	uint64_t from = rec.tick(0) + static_cast<uint64_t>(skip * 1e9);
+	uint64_t until = duration > 0 ? from + static_cast<uint64_t>(duration * 1e9) : UINT64_MAX;
+
+	size_t first = 0;
+	while (first < count && rec.tick(first) < from) ++first;
+
+	size_t last = first;
+	while (last + 1 < count && rec.tick(last + 1) <= until) ++last;
+
+	if (first >= count || last == first) {
+		throw std::runtime_error("fewer than two records in the selected range");
+	}
+
+	std::ostringstream mean, peak;
+	uint64_t min_ns = window * 1e9;
+	if (min_ns > rec.tick(last) - rec.tick(first)) {
+		throw std::runtime_error("the window is longer than the selected range");
+	}
+
+	for (size_t n = 0; n < rec.iface_count(); ++n) {
+		auto& iface = rec.iface(n);
+
+		//
+		// only the records where the NIC's sample time changed hold a
+		// new sample - the others just repeat it
+		//
+		std::vector<size_t> samples;
+		for (size_t r = first; r <= last; ++r) {
+			if (samples.empty() || rec.stamp(r, n) != rec.stamp(samples.back(), n)) {
+				samples.push_back(r);
+			}
+		}
+
+		for (size_t row = 0; row < iface.rows; ++row) {
+
+			auto label = row ? std::to_string(row - 1) : std::string(iface.name);
+			auto present = rec.present(n, row);
+
+			if (samples.size() < 2) {
+				out_data(mean, label, rates_t { }, 0);
+				out_data(peak, label, rates_t { }, 0);
+				continue;
+			}
+
+			auto a = samples.front(), b = samples.back();
+			out_data(mean, label, rates(rec.counts(a, n, row), rec.counts(b, n, row),
+						    rec.stamp(b, n) - rec.stamp(a, n)), present);
+
+			//
+			// for each sample `j`, the window runs back to the latest
+			// sample `i` that's at least the requested length before it
+			//
+			rates_t max { };
+			for (size_t i = 0, j = 1; j < samples.size(); ++j) {
+				auto tj = rec.stamp(samples[j], n);
+				while (i + 1 < j && tj - rec.stamp(samples[i + 1], n) >= min_ns) ++i;
+
+				auto ti = rec.stamp(samples[i], n);
+				if (tj - ti < min_ns) continue;
+
+				auto r = rates(rec.counts(samples[i], n, row), rec.counts(samples[j], n, row), tj - ti);
+				for (size_t k = 0; k < 4; ++k) {
+					max[k] = std::max(max[k], r[k]);
+				}
+			}
+			out_data(peak, label, max, present);
+		}
+	}
+
+	std::cout << "recorded " << wall_time(rec, rec.tick(first)) << " to "
+		  << wall_time(rec, rec.tick(last)) << " UTC, "
+		  << (last - first + 1) << " records at "
+		  << std::fixed << std::setprecision(3) << rec.interval() / 1e9 << "s intervals\n\n";
+
+	std::cout << "mean rates\n";
+	out_hdr(std::cout);
+	std::cout << mean.str() << "\n";
+
+	std::cout << "peak rates";
+	if (window > 0) {
+		std::cout << " over " << std::setprecision(3) << window << "s windows";
+	}
+	std::cout << "\n";
+	out_hdr(std::cout);
+	std::cout << peak.str();
+}
+
+int main(int argc, char *argv[])
+{
+	int opt;
+	double skip = 0, duration = 0, window = 0;
+
+	while ((opt = getopt(argc, argv, "d:hs:w:")) != -1) {
+		switch (opt) {
+			case 'd':
+				duration = seconds(optarg);
+				break;
+			case 's':
+				skip = seconds(optarg);
+				break;
+			case 'w':
+				window = seconds(optarg);
+				break;
+			case 'h':
+				usage();
+			default:
+				usage(EXIT_FAILURE);
+		}
+	}
+
+	if (optind != argc - 1) {
+		usage(EXIT_FAILURE);
+	}
+
+	try {
+		Recording rec(argv[optind]);
+		report(rec, skip, duration, window);
+	} catch (const std::exception& e) {
+		std::cerr << "error: " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -44,6 +44,14 @@ void test(StringsetParser* parser, std::istream& is)
 		bool match_total = parser->match_total(key, value, rx, bytes);
 		bool match_queue = parser->match_queue(key, value, rx, bytes, queue);
 
+		// drop counters are only tried for stats that aren't throughput
+		bool drop = false;
+		if (!match_total && !match_queue) {
+			match_total = parser->match_drop_total(key, value, rx);
+			match_queue = parser->match_drop_queue(key, value, rx, queue);
+			drop = match_total || match_queue;
+		}
+
 		// generate output
 		std::cout << std::setw(3) << lineno++ << " | ";
 		if (match_total || match_queue) {
@@ -55,7 +63,7 @@ void test(StringsetParser* parser, std::istream& is)
 			}
 			std::cout << (match_total ? "=" : " ");
 			std::cout << " " << (rx ? "rx" : "tx");
-			std::cout << " " << (bytes ? "b" : "p");
+			std::cout << " " << (drop ? "d" : bytes ? "b" : "p");
 			std::cout << " ";
 		} else {
 			std::cout << "          ";
@@ -38,21 +38,16 @@ size_t Ethtool::stringset_size(ethtool_stringset ss)
 		return iter->second;
 	}
 
-	// allocate memory on stack
-	auto size = sizeof(ethtool_sset_info) + sizeof(__u32);
-	auto p = reinterpret_cast<char*>(alloca(size));
-	if (!p) {
-		throw_errno("alloca");
-	}
-	std::fill(p, p + size, 0);
+	// room for the single result after the header
+	__u64 buf[(sizeof(ethtool_sset_info) + sizeof(__u32) + 7) / 8] = { };
 
 	// shadow the allocation
-	auto& sset_info = *reinterpret_cast<ethtool_sset_info*>(p);
+	auto& sset_info = *reinterpret_cast<ethtool_sset_info*>(buf);
 
 	// get the data
 	sset_info.cmd = ETHTOOL_GSSET_INFO;
 	sset_info.reserved = 0;
-	sset_info.sset_mask = (1 << ss);
+	sset_info.sset_mask = (1ULL << ss);
 	ioctl(&sset_info);
 
 	auto result = sset_info.data[0];
@@ -66,57 +61,67 @@ Ethtool::stringset_t Ethtool::stringset(ethtool_stringset ss)
 	// determine size
 	size_t count = stringset_size(ss);
 
-	// allocate sufficient memory on stack
+	//
+	// allocate sufficient memory on the heap - this is only done
+	// at startup, and some NICs have very large string sets
+	//
 	auto size = sizeof(ethtool_gstrings) + count * ETH_GSTRING_LEN;
-	auto p = reinterpret_cast<char*>(alloca(size));
-	if (!p) {
-		throw_errno("alloca");
-	}
-	std::fill(p, p + size, 0);
+	std::vector<char> buf(size);
 
 	// shadow the allocation
-	auto& gstrings = *reinterpret_cast<ethtool_gstrings*>(p);
+	auto& gstrings = *reinterpret_cast<ethtool_gstrings*>(buf.data());
 
 	// get the data
 	gstrings.cmd = ETHTOOL_GSTRINGS;
 	gstrings.string_set = ss;
+	gstrings.len = count;
 	ioctl(&gstrings);
 
 	// build the result set
 	stringset_t result;
 	result.reserve(count);
-	for (unsigned int i = 0; i < gstrings.len; ++i) {
+	for (unsigned int i = 0; i < gstrings.len && i < count; ++i) {
 		auto p = reinterpret_cast<char *>(gstrings.data) + i * ETH_GSTRING_LEN;
-		result.emplace_back(p);		// assume NUL terminated
+		result.emplace_back(p, strnlen(p, ETH_GSTRING_LEN));
 	}
 
 	return result;
 }
 
-Ethtool::stats_t Ethtool::stats()
+//
+// the driver info is fetched first each time - it's a single cheap
+// ioctl that carries the current number of stats, so that a change of
+// channels (e.g. `ethtool -L`) or of driver is noticed before the stats
+// are read into a snapshot of the wrong size
+//
+void Ethtool::stats(snapshot_t& snap)
 {
-	size_t count = stringset_size(ETH_SS_STATS);
+	ethtool_drvinfo info = { };
+	info.cmd = ETHTOOL_GDRVINFO;
+	ioctl(&info);
 
-	// allocate memory on stack
-	auto size = sizeof(ethtool_stats) + count * sizeof(__u64);
-	auto p = reinterpret_cast<char *>(alloca(size));
-	if (!p) {
-		throw_errno("alloca");
+	if (info.n_stats != drvinfo.n_stats) {
+		sizes.clear();
 	}
-	std::fill(p, p + size, 0);
 
-	// shadow the allocation
-	auto& stats = *reinterpret_cast<ethtool_stats*>(p);
+	if (strncmp(info.driver, drvinfo.driver, sizeof info.driver) ||
+	    strncmp(info.version, drvinfo.version, sizeof info.version))
+	{
+		sizes.clear();
+		++_generation;
+	}
+	drvinfo = info;
 
-	// get the data
-	stats.cmd = ETHTOOL_GSTATS;
-	ioctl(&stats);
+	size_t count = stringset_size(ETH_SS_STATS);
 
-	// build the result set
-	stats_t result(count);
-	std::copy(stats.data, stats.data + stats.n_stats, result.begin());
+	// no-op unless the snapshot is new
+	snap.resize(count);
 
-	return result;
+	// the kernel fills the snapshot in place
+	auto& stats = *snap.header();
+	stats.cmd = ETHTOOL_GSTATS;
+	stats.n_stats = count;
+	ioctl(&stats);
 }
 
 Ethtool::Ethtool(const std::string& ifname)
@@ -18,11 +18,11 @@
 #include <net/if.h>
 #include <linux/ethtool.h>
 
-class Ethtool {
+#include "source.h"
+
+class Ethtool : public StatsSource {
 
 public:
-	typedef std::vector<std::string> stringset_t;
-	typedef std::vector<__u64> stats_t;
 	typedef std::map<int, size_t> stringset_size_t;
 
 private:
@@ -30,6 +30,7 @@ private:
 	ifreq			ifr;
 	stringset_size_t	sizes;
 	ethtool_drvinfo		drvinfo;
+	unsigned		_generation = 0;
 
 private:
 	void			ioctl(void *data);
@@ -41,7 +42,8 @@ public:
 public:
 	size_t			stringset_size(ethtool_stringset ss);
 	stringset_t		stringset(ethtool_stringset);
-	stats_t			stats();
+	void			stats(snapshot_t& snap);
+	unsigned		generation()	{ return _generation; };
 
 	std::string		driver()	{ return std::string(drvinfo.driver); };
 	std::string		version()	{ return std::string(drvinfo.version); };
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <net/if.h>
+#include <linux/ethtool_netlink.h>
+
+#include "ethtool_nl.h"
+#include "ethtool++.h"
+#include "netlink.h"
+#include "util.h"
+
+//
+// the synthesized stats strings, in the generic driver's format,
+// and the IEEE 802.3 MAC attributes that supply their values
+//
+static const char* names[] = {
+	"tx_packets", "rx_packets", "tx_bytes", "rx_bytes"
+};
+
+static const uint16_t attrs[] = {
+	ETHTOOL_A_STATS_ETH_MAC_2_TX_PKT,
+	ETHTOOL_A_STATS_ETH_MAC_5_RX_PKT,
+	ETHTOOL_A_STATS_ETH_MAC_8_TX_BYTES,
+	ETHTOOL_A_STATS_ETH_MAC_14_RX_BYTES,
+};
+
+static const size_t count = sizeof(names) / sizeof(names[0]);
+
+namespace {
+
+struct entry_t {
+	std::vector<__u64>	values = std::vector<__u64>(count);
+	bool			seen = false;
+};
+
+}
+
+class EthtoolNetlink::Batch : public NetlinkDump<entry_t> {
+
+private:
+	uint16_t		family;
+
+	NetlinkMessage		request();
+	void			parse(const nlmsghdr* nlh);
+
+public:
+	Batch();
+};
+
+EthtoolNetlink::Batch::Batch()
+	: NetlinkDump(NETLINK_GENERIC)
+{
+	family = nl.family(ETHTOOL_GENL_NAME);
+}
+
+void EthtoolNetlink::Batch::parse(const nlmsghdr* nlh)
+{
+	int ifindex = 0;
+	entry_t* entry = nullptr;
+
+	Netlink::genl_attrs(nlh).each([&](uint16_t type, const nlattr* a) {
+
+		if (type == ETHTOOL_A_STATS_HEADER) {
+			NetlinkAttrs::nested(a).each([&](uint16_t type, const nlattr* a) {
+				if (type == ETHTOOL_A_HEADER_DEV_INDEX) {
+					ifindex = NetlinkAttrs::u32(a);
+				}
+			});
+			entry = slot(ifindex);
+			return;
+		}
+
+		// skip groups for interfaces we're not monitoring
+		if (type != ETHTOOL_A_STATS_GRP || !entry) {
+			return;
+		}
+
+		uint32_t id = -1;
+		auto grp = NetlinkAttrs::nested(a);
+		grp.each([&](uint16_t type, const nlattr* a) {
+			if (type == ETHTOOL_A_STATS_GRP_ID) {
+				id = NetlinkAttrs::u32(a);
+			}
+		});
+
+		if (id != ETHTOOL_STATS_ETH_MAC) {
+			return;
+		}
+
+		grp.each([&](uint16_t type, const nlattr* a) {
+			if (type != ETHTOOL_A_STATS_GRP_STAT) return;
+			NetlinkAttrs::nested(a).each([&](uint16_t type, const nlattr* a) {
+				for (size_t i = 0; i < count; ++i) {
+					if (type == attrs[i]) {
+						entry->values[i] = NetlinkAttrs::u64(a);
+						entry->seen = true;
+					}
+				}
+			});
+		});
+	});
+}
+
+NetlinkMessage EthtoolNetlink::Batch::request()
+{
+	NetlinkMessage msg(family, NLM_F_DUMP);
+
+	genlmsghdr genl = { };
+	genl.cmd = ETHTOOL_MSG_STATS_GET;
+	genl.version = ETHTOOL_GENL_VERSION;
+	msg.put(&genl, sizeof genl);
+
+	// request just the MAC group as a compact bitset
+	// NB: the kernel always returns the group, but omits any
+	// counters that the driver doesn't implement
+	uint32_t groups = (1 << ETHTOOL_STATS_ETH_MAC);
+	msg.nest_begin(ETHTOOL_A_STATS_GROUPS);
+	msg.put_flag(ETHTOOL_A_BITSET_NOMASK);
+	msg.put_u32(ETHTOOL_A_BITSET_SIZE, __ETHTOOL_STATS_CNT);
+	msg.put_attr(ETHTOOL_A_BITSET_VALUE, &groups, sizeof groups);
+	msg.nest_end();
+
+	return msg;
+}
+
+EthtoolNetlink::EthtoolNetlink(const std::string& ifname)
+	: _name(ifname)
+{
+	ifindex = if_nametoindex(ifname.c_str());
+	if (!ifindex) {
+		throw_errno("if_nametoindex(" + ifname + ")");
+	}
+
+	// the driver details still come from a one-off ioctl
+	{
+		Ethtool ethtool(ifname);
+		_driver = ethtool.driver();
+		_version = ethtool.version();
+	}
+
+	batch = shared_dump<Batch>();
+	batch->add(ifindex);
+	if (!batch->supported(ifindex)) {
+		batch->remove(ifindex);
+		throw std::runtime_error("no ethtool netlink MAC stats for " + _driver + ":" + ifname);
+	}
+}
+
+EthtoolNetlink::~EthtoolNetlink()
+{
+	batch->remove(ifindex);
+}
+
+EthtoolNetlink::stringset_t EthtoolNetlink::stringset(ethtool_stringset ss)
+{
+	stringset_t result;
+	if (ss == ETH_SS_STATS) {
+		result.assign(names, names + count);
+	}
+	return result;
+}
+
+void EthtoolNetlink::stats(snapshot_t& snap)
+{
+	_stamp = batch->get(ifindex, [&](entry_t& entry) {
+		snap.resize(count);
+		std::copy(entry.values.begin(), entry.values.end(), snap.data());
+	});
+}
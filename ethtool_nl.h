@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "source.h"
+
+//
+// reads the standard IEEE 802.3 MAC counters via the ethtool generic
+// netlink family instead of copying the driver's entire private stats
+// table with SIOCETHTOOL
+//
+// all instances share a single netlink socket, and one STATS_GET dump
+// per tick retrieves the counters for every interface in a single
+// request - the first interface to ask for its stats in a tick triggers
+// the dump, and the others consume the values it already fetched - so
+// they're all timestamped at the midpoint of that dump, not of the read
+//
+// only NIC totals are available this way, there are no per-queue stats
+//
+class EthtoolNetlink : public StatsSource {
+
+public:
+	class Batch;
+
+private:
+	Batch*			batch;
+
+	std::string		_name;
+	int			ifindex;
+	std::string		_driver;
+	std::string		_version;
+	uint64_t		_stamp = 0;
+
+public:
+				EthtoolNetlink(const std::string& ifname);
+				~EthtoolNetlink();
+
+public:
+	stringset_t		stringset(ethtool_stringset);
+	void			stats(snapshot_t& snap);
+	uint64_t		stamp()		{ return _stamp; };
+
+	std::string		driver()	{ return _driver; };
+	std::string		version()	{ return _version; };
+	std::string		parser()	{ return "generic"; };
+};
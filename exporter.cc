@@ -0,0 +1,322 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include "exporter.h"
+#include "format.h"
+#include "util.h"
+
+// in Interface::ifstats_t order
+static const char* counters[] = {
+	"tx_packets", "rx_packets", "tx_bytes", "rx_bytes", "tx_drops", "rx_drops"
+};
+static const char* helps[] = {
+	"Packets transmitted", "Packets received",
+	"Bytes transmitted", "Bytes received",
+	"Packets dropped on transmit", "Packets dropped on receive"
+};
+static const size_t ncounters = sizeof counters / sizeof counters[0];
+
+static std::string escape(const std::string& s)
+{
+	std::string res;
+	for (auto c: s) {
+		if (c == '\\' || c == '"') {
+			res += '\\';
+			res += c;
+		} else if (c == '\n') {
+			res += "\\n";
+		} else {
+			res += c;
+		}
+	}
+	return res;
+}
+
+Exporter::Exporter(const std::string& listen, const ifaces_t& ifaces)
+	: ifaces(ifaces)
+{
+	// split [address:]port, allowing for [ipv6]:port
+	std::string host = "127.0.0.1";
+	std::string port = listen;
+
+	auto colon = listen.rfind(':');
+	if (colon != std::string::npos) {
+		host = listen.substr(0, colon);
+		port = listen.substr(colon + 1);
+		if (host.size() >= 2 && host.front() == '[' && host.back() == ']') {
+			host = host.substr(1, host.size() - 2);
+		}
+	}
+
+	addrinfo hints = { };
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_PASSIVE;
+
+	addrinfo* res;
+	auto err = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &res);
+	if (err) {
+		throw std::runtime_error("can't resolve " + listen + ": " + gai_strerror(err));
+	}
+
+	for (auto ai = res; ai && listen_fd < 0; ai = ai->ai_next) {
+		auto fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+		if (fd < 0) continue;
+
+		int on = 1;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on);
+
+		if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && ::listen(fd, 16) == 0) {
+			listen_fd = fd;
+		} else {
+			err = errno;
+			close(fd);
+		}
+	}
+	freeaddrinfo(res);
+
+	if (listen_fd < 0) {
+		errno = err;
+		throw_errno("listen(" + listen + ")");
+	}
+
+	if (pipe2(stop_fds, O_CLOEXEC) < 0) {
+		close(listen_fd);
+		throw_errno("pipe2");
+	}
+
+	// publish the initial (zero) counters before accepting scrapes
+	update();
+
+	thread = std::thread(&Exporter::serve, this);
+}
+
+Exporter::~Exporter()
+{
+	if (write(stop_fds[1], "", 1) < 0) {
+		// the thread's stuck in a scrape, which will time out
+	}
+	thread.join();
+
+	close(stop_fds[0]);
+	close(stop_fds[1]);
+	close(listen_fd);
+}
+
+//
+// (re)build the label prefixes for a NIC, e.g.
+//
+//   ethq_queue_rx_bytes_total{interface="eth0",driver="ixgbe",queue="3"}
+//
+// the NIC's queues can change at runtime, and a NIC that comes back
+// after being unplugged is a new Interface in the same slot, but the
+// totals for the NIC and for any queues it still has are kept so that
+// they never go back
+//
+void Exporter::setup(size_t n)
+{
+	auto& iface = ifaces[n];
+	owners[n] = iface;
+	auto rows = iface->queue_count() + 1;
+
+	auto labels = "interface=\"" + escape(iface->name()) +
+		      "\",driver=\"" + escape(iface->driver()) + "\"";
+
+	auto& prefix = prefixes[n];
+	prefix.clear();
+	for (size_t row = 0; row < rows; ++row) {
+		for (auto counter: counters) {
+			if (row == 0) {
+				prefix.push_back(std::string("ethq_") + counter + "_total{" + labels + "} ");
+			} else {
+				prefix.push_back(std::string("ethq_queue_") + counter + "_total{" + labels +
+						 ",queue=\"" + std::to_string(row - 1) + "\"} ");
+			}
+		}
+	}
+
+	totals[n].resize(rows * ncounters);
+}
+
+void Exporter::update()
+{
+	// interfaces can be added at runtime
+	if (owners.size() != ifaces.size()) {
+		totals.resize(ifaces.size());
+		stamps.resize(ifaces.size());
+		prefixes.resize(ifaces.size());
+		owners.resize(ifaces.size());
+	}
+
+	// accumulate any new results
+	for (size_t n = 0; n < ifaces.size(); ++n) {
+		auto& iface = ifaces[n];
+		auto rows = iface->queue_count() + 1;
+
+		if (owners[n] != iface || prefixes[n].size() != rows * ncounters) {
+			setup(n);
+		}
+
+		auto stamp = iface->timestamp();
+		if (stamp == stamps[n]) continue;
+		stamps[n] = stamp;
+
+		auto t = totals[n].data();
+		for (size_t row = 0; row < rows; ++row, t += ncounters) {
+			auto& stats = row ? iface->queue_stats(row - 1) : iface->total_stats();
+			for (size_t k = 0; k < ncounters; ++k) {
+				t[k] += stats.counts[k];
+			}
+		}
+	}
+
+	//
+	// render the page - each metric family's samples must be together,
+	// so it's NIC totals for each counter, then the queues
+	//
+	auto& page = pages.back();
+	page.clear();
+
+	char num[fmt_max];
+	for (size_t queues = 0; queues < 2; ++queues) {
+		for (size_t k = 0; k < ncounters; ++k) {
+			auto name = std::string(queues ? "ethq_queue_" : "ethq_") + counters[k] + "_total";
+			page += "# HELP " + name + " " + helps[k] + (queues ? " by the queue\n" : " by the NIC\n");
+			page += "# TYPE " + name + " counter\n";
+
+			for (size_t n = 0; n < ifaces.size(); ++n) {
+				auto& iface = ifaces[n];
+				if (iface->detached()) continue;
+
+				auto& prefix = prefixes[n];
+				auto rows = prefix.size() / ncounters;
+
+				for (size_t row = queues; row < (queues ? rows : 1); ++row) {
+					auto& stats = row ? iface->queue_stats(row - 1) : iface->total_stats();
+					if (!stats.has(k)) continue;
+
+					page += prefix[row * ncounters + k];
+					page.append(num, fmt_u64(num, totals[n][row * ncounters + k]) - num);
+					page += '\n';
+				}
+			}
+		}
+	}
+
+	pages.publish();
+}
+
+void Exporter::serve()
+{
+	pollfd fds[2] = {
+		{ listen_fd, POLLIN, 0 },
+		{ stop_fds[0], POLLIN, 0 }
+	};
+
+	while (true) {
+		if (poll(fds, 2, -1) < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+
+		if (fds[1].revents) {
+			break;
+		}
+
+		if (fds[0].revents & POLLIN) {
+			auto fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+			if (fd >= 0) {
+				respond(fd);
+				close(fd);
+			}
+		}
+	}
+}
+
+//
+// a minimal HTTP/1.x responder - one request per connection
+//
+void Exporter::respond(int fd)
+{
+	timeval tv = { 2, 0 };
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof tv);
+
+	// read just the request headers
+	char req[4096];
+	size_t len = 0;
+	while (len < sizeof req - 1) {
+		auto res = recv(fd, req + len, sizeof req - 1 - len, 0);
+		if (res <= 0) {
+			if (res < 0 && errno == EINTR) continue;
+			return;
+		}
+		len += res;
+		req[len] = '\0';
+		if (strstr(req, "\r\n\r\n") || strstr(req, "\n\n")) break;
+	}
+	req[len] = '\0';
+
+	auto send_all = [&](const char* p, size_t n) {
+		while (n > 0) {
+			auto res = send(fd, p, n, MSG_NOSIGNAL);
+			if (res < 0) {
+				if (errno == EINTR) continue;
+				return false;
+			}
+			p += res;
+			n -= res;
+		}
+		return true;
+	};
+
+	bool get = strncmp(req, "GET ", 4) == 0;
+	bool head = strncmp(req, "HEAD ", 5) == 0;
+	auto path = req + (head ? 5 : 4);
+	bool metrics = (get || head) && strncmp(path, "/metrics", 8) == 0 &&
+		       (path[8] == ' ' || path[8] == '?');
+
+	if (!metrics) {
+		static const char notfound[] =
+			"HTTP/1.1 404 Not Found\r\n"
+			"Content-Type: text/plain\r\n"
+			"Content-Length: 10\r\n"
+			"Connection: close\r\n\r\n"
+			"not found\n";
+		send_all(notfound, sizeof notfound - 1);
+		return;
+	}
+
+	pages.acquire();
+	auto& page = pages.front();
+
+	char hdr[256];
+	auto n = snprintf(hdr, sizeof hdr,
+		"HTTP/1.1 200 OK\r\n"
+		"Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+		"Content-Length: %zu\r\n"
+		"Connection: close\r\n\r\n", page.size());
+
+	if (send_all(hdr, n) && get) {
+		send_all(page.data(), page.size());
+	}
+}
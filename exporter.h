@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "render.h"
+#include "tribuf.h"
+
+//
+// serves the cumulative NIC and per-queue counters at /metrics in the
+// Prometheus text exposition format
+//
+// the page is rendered once per tick by update(), on the sampling
+// side, into a reusable buffer with all of the metric names and labels
+// preformatted - it's then handed to the HTTP thread through a triple
+// buffer, so a scrape just copies out the latest page and never causes
+// any extra reads from the NICs
+//
+class Exporter {
+
+private:
+	const ifaces_t&			ifaces;
+
+	// running totals, one per counter per row, and the sample they're up to
+	std::vector<std::vector<uint64_t>>	totals;
+	std::vector<uint64_t>		stamps;
+
+	//
+	// for each NIC, the text that precedes the value of each of its
+	// counters, in the order they're rendered
+	//
+	std::vector<std::vector<std::string>>	prefixes;
+
+	// the Interface that each NIC's prefixes were built for
+	std::vector<std::shared_ptr<Interface>>	owners;
+
+	TripleBuffer<std::string>	pages;
+
+	int				listen_fd = -1;
+	int				stop_fds[2] = { -1, -1 };
+	std::thread			thread;
+
+	void				setup(size_t n);
+	void				serve();
+	void				respond(int fd);
+
+public:
+	// `listen` is [address:]port, the address defaulting to 127.0.0.1
+	Exporter(const std::string& listen, const ifaces_t& ifaces);
+	~Exporter();
+
+	// render the interfaces' latest results
+	void				update();
+};
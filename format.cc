@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <cmath>
+#include <cstring>
+
+#include "format.h"
+
+char* fmt_u64(char* p, uint64_t n)
+{
+	char buf[20];
+	char* q = buf + sizeof buf;
+
+	do {
+		*--q = '0' + (n % 10);
+		n /= 10;
+	} while (n);
+
+	auto len = buf + sizeof buf - q;
+	memcpy(p, q, len);
+	return p + len;
+}
+
+char* fmt_fixed(char* p, double v, unsigned places)
+{
+	static const uint64_t scales[] = {
+		1, 10, 100, 1000, 10000, 100000, 1000000, 10000000,
+		100000000, 1000000000
+	};
+
+	if (!std::isfinite(v) || std::fabs(v) >= 1.8e19) {
+		*p++ = '-';
+		return p;
+	}
+
+	if (v < 0) {
+		*p++ = '-';
+		v = -v;
+	}
+
+	// split first, so that large values don't lose their fraction
+	auto scale = scales[places];
+	auto whole = std::floor(v);
+	auto frac = static_cast<uint64_t>(std::nearbyint((v - whole) * scale));
+	auto n = static_cast<uint64_t>(whole);
+	if (frac >= scale) {
+		frac -= scale;
+		++n;
+	}
+
+	p = fmt_u64(p, n);
+	if (places) {
+		*p++ = '.';
+
+		// the fraction, with leading zeros
+		for (auto s = scale / 10; s > 0; s /= 10) {
+			*p++ = '0' + (frac / s) % 10;
+		}
+	}
+
+	return p;
+}
+
+char* fmt_si(char* p, double v)
+{
+	static const char units[] = " KMGTPE";
+
+	if (!std::isfinite(v) || v < 0) {
+		*p++ = '-';
+		return p;
+	}
+
+	// scale so that the rounded value is below 1000
+	size_t u = 0;
+	while (v >= 999.5 && u < sizeof units - 2) {
+		v /= 1000;
+		++u;
+	}
+
+	if (u == 0) {
+		return fmt_u64(p, static_cast<uint64_t>(v + 0.5));
+	}
+
+	if (v < 9.995) {
+		p = fmt_fixed(p, v, 2);
+	} else if (v < 99.95) {
+		p = fmt_fixed(p, v, 1);
+	} else {
+		p = fmt_fixed(p, v, 0);
+	}
+
+	*p++ = units[u];
+	return p;
+}
+
+char* fmt_right(char* p, size_t width, const char* s, size_t len)
+{
+	if (len < width) {
+		memset(p, ' ', width - len);
+		p += width - len;
+	}
+
+	memcpy(p, s, len);
+	return p + len;
+}
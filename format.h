@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//
+// allocation-free number formatting, for the per-tick output paths
+//
+// each function writes its text at `p` (without a terminating NUL)
+// and returns a pointer just past the end of it - the caller must
+// ensure there's room for at least `fmt_max` characters
+//
+
+static const size_t fmt_max = 24;
+
+// decimal integer
+extern char* fmt_u64(char* p, uint64_t n);
+
+// fixed-point, rounded to `places` decimal places (at most 9)
+extern char* fmt_fixed(char* p, double v, unsigned places);
+
+//
+// three significant figures with an SI multiplier suffix, e.g. "999",
+// "1.23K", "45.6M" - never more than five characters for values below
+// 1000 exa
+//
+extern char* fmt_si(char* p, double v);
+
+// copy `len` chars from `s` right-aligned in a field of `width`,
+// extending the field if it's too narrow, as per std::setw
+extern char* fmt_right(char* p, size_t width, const char* s, size_t len);
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "histogram.h"
+
+//
+// bucket `b` of the power of two 2^e (for e >= sub_bits) covers
+// [(subs + b) << (e - sub_bits), (subs + b + 1) << (e - sub_bits))
+//
+size_t Histogram::bucket(uint64_t v)
+{
+	if (v < subs) {
+		return v;
+	}
+
+	unsigned e = 63 - __builtin_clzll(v);
+	auto shift = e - sub_bits;
+	return (shift + 1) * subs + ((v >> shift) & (subs - 1));
+}
+
+void Histogram::add(uint64_t v)
+{
+	auto& b = buckets[bucket(v)];
+	if (b < UINT32_MAX) {
+		++b;
+	}
+
+	++n;
+	lo = std::min(lo, v);
+	hi = std::max(hi, v);
+	sum += v;
+}
+
+uint64_t Histogram::percentile(double p) const
+{
+	if (n == 0) {
+		return 0;
+	} else if (p <= 0) {
+		return lo;
+	} else if (p >= 1) {
+		return hi;
+	}
+
+	uint64_t rank = std::max(std::ceil(p * n), 1.0);
+	uint64_t seen = 0;
+
+	for (size_t i = 0; i < nbuckets; ++i) {
+		seen += buckets[i];
+		if (seen < rank) continue;
+
+		if (i < subs) {
+			return i;
+		}
+
+		auto shift = i / subs - 1;
+		auto base = (subs + i % subs) << shift;
+		auto mid = base + ((UINT64_C(1) << shift) - 1) / 2;
+		return std::min(std::max(mid, lo), hi);
+	}
+
+	return hi;
+}
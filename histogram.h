@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+//
+// a fixed-size log-bucketed histogram of unsigned values
+//
+// values below 16 each have their own bucket, and every power of two
+// above that is split into 16 equal buckets, so that percentiles are
+// reported (as the middle of their bucket) to within about 3% over
+// the whole 64-bit range, in under 4KB - the minimum, maximum and
+// mean are kept exactly
+//
+class Histogram {
+
+private:
+	static const unsigned		sub_bits = 4;
+	static const unsigned		subs = 1U << sub_bits;
+	static const size_t		nbuckets = (64 - sub_bits + 1) * subs;
+
+	std::array<uint32_t, nbuckets>	buckets = { };
+	uint64_t			n = 0;
+	uint64_t			lo = UINT64_MAX;
+	uint64_t			hi = 0;
+	double				sum = 0;
+
+	static size_t			bucket(uint64_t v);
+
+public:
+	void				add(uint64_t v);
+
+	uint64_t			count() const	{ return n; };
+	uint64_t			min() const	{ return n ? lo : 0; };
+	uint64_t			max() const	{ return hi; };
+	double				mean() const	{ return n ? sum / n : 0; };
+
+	// the value at fraction `p` (0 to 1) of the way through the distribution
+	uint64_t			percentile(double p) const;
+};
@@ -9,170 +9,447 @@
  * information regarding copyright ownership.
  */
 
+#include <algorithm>
+#include <cmath>
+#include <iterator>
 #include <stdexcept>
+
 #include "interface.h"
+#include "ethtool++.h"
+#include "ethtool_nl.h"
+#include "linkstats.h"
+#include "netdev_nl.h"
 #include "parser.h"
+#include "statsmap.h"
+#include "util.h"
 
-Interface::Interface(const std::string& name, bool generic)
-	: _name(name)
+static StatsSource* open_source(const std::string& name, Interface::source_t from)
 {
-	ethtool = new Ethtool(name);
-	state = ethtool->stats();
+	switch (from) {
+		case Interface::NETDEV_NETLINK:
+			return new NetdevNetlink(name);
+		case Interface::ETHTOOL_NETLINK:
+			return new EthtoolNetlink(name);
+		case Interface::LINK_STATS:
+			return new LinkStats(name);
+		default:
+			return new Ethtool(name);
+	}
+}
 
-	// find the right code to parse this NIC's stats output
-	auto driver = ethtool->driver();
-	const auto info = driver + ":" + name;
+// offsets 4 and 5 of ifstats_t hold the drop counts
+static bool is_drop(size_t offset)
+{
+	return offset >= 4;
+}
 
-	auto parser = StringsetParser::find(driver);
-	if (!parser) {
-		if (!generic) {
-			throw std::runtime_error("Unsupported NIC driver " + info);
-		}
+Interface::Interface(const std::string& name, bool generic, source_t from)
+	: Interface(name, open_source(name, from), generic)
+{
+}
 
-		parser = StringsetParser::find("generic");
-		if (!generic) {
-			throw std::runtime_error("Failed fallback from " + info + " to generic");
-		}
-	}
+Interface::Interface(const std::string& name, StatsSource* source, bool generic)
+	: _name(name), generic(generic), source(source)
+{
+	auto& state = snaps[front];
+	sample(state);
+
+	_driver = source->driver();
+	build_stats_map(state);
 
-	// parse the list of stats strings
-	build_stats_map(parser);
-	if (tmap.size() == 0 && qmap.size() == 0) {
-		throw std::runtime_error("couldn't parse NIC stats for " + info);
+	//
+	// a NIC with only per-queue counters that are all idle for now is
+	// just a totals row until they're not - but if nothing matched at
+	// all the parser doesn't understand this NIC
+	//
+	if (gather.empty() && watch.empty()) {
+		throw std::runtime_error("couldn't parse NIC stats for " + _driver + ":" + name);
 	}
+
+	// nothing is reading the results yet
+	results.each([&](result_t& result) {
+		result.rows = layout;
+		result.layout = layout_id;
+		result.stamp = stamp;
+	});
 }
 
 Interface::~Interface()
 {
-	delete ethtool;
 }
 
-const std::string Interface::name() const
+const std::string& Interface::name() const
 {
 	return _name;
 }
 
+const std::string& Interface::driver() const
+{
+	return _driver;
+}
+
+//
+// read the counters, timestamped at the midpoint of the read so that
+// rates reflect the real time between samples even when a slow
+// driver or a busy system makes the read late - unless the source
+// knows when they were sampled, in which case this returns false if
+// they're no newer than the previous ones
+//
+bool Interface::sample(StatsSource::snapshot_t& snap)
+{
+	auto before = clock_ns();
+	source->stats(snap);
+	auto after = clock_ns();
+
+	auto taken = source->stamp();
+	auto now = taken ? taken : before + (after - before) / 2;
+	if (now == stamp) {
+		return false;
+	}
+
+	elapsed = stamp ? now - stamp : 0;
+	stamp = now;
+	read_time = after - before;
+	return true;
+}
+
+//
+// cheap checks for a change of queues or stats - the source's string
+// set generation and size, and any previously idle queue counters
+//
+bool Interface::reconfigured(const StatsSource::snapshot_t& state)
+{
+	if (source->generation() != generation || state.size() != nstats) {
+		return true;
+	}
+
+	auto s = state.data();
+	for (auto i: watch) {
+		if (s[i]) return true;
+	}
+
+	return false;
+}
+
 void Interface::refresh()
 {
-	auto stats = ethtool->stats();
+	if (_detached) {
+		return;
+	}
 
-	// reset total counters
-	for (size_t i = 0; i < 4; ++i) {
-		tstats.counts[i].reset();
+	auto start = clock_ns();
+	auto& stats = snaps[front ^ 1];
+	if (!sample(stats)) {
+		return;
 	}
 
-	// reset queue counters
-	for (auto& stats: qstats) {
-		for (size_t i = 0; i < 4; ++i) {
-			stats.counts[i].reset();
-		}
+	if (reconfigured(stats)) {
+		build_stats_map(stats);
+		front ^= 1;
+		return;
 	}
 
-	// accumulate total counters
-	for (const auto& pair: tmap) {
+	auto n = gather.size();
+	auto s = stats.data();
+	auto g = gather.data();
+	auto p = previous.data();
+	auto c = current.data();
+	auto d = delta.data();
+
+	// pick out just the mapped values
+	for (size_t i = 0; i < n; ++i) {
+		c[i] = s[g[i]];
+	}
 
-		auto index = pair.first;
-		auto offset = pair.second;
+	// record the differences in value, ignoring counter resets
+	for (size_t i = 0; i < n; ++i) {
+		d[i] = (c[i] > p[i]) ? (c[i] - p[i]) : 0;
+	}
 
-		uint64_t prev = state[index];
-		uint64_t current = stats[index];
+	// reset and accumulate the total and queue counters
+	auto& result = results.back();
+	if (result.layout != layout_id) {
+		result.rows = layout;
+		result.layout = layout_id;
+	}
 
-		// record the difference in value
-		uint64_t delta = (current > prev) ? (current - prev) : 0;
-		tstats.counts[offset] += delta;
+	auto rows = result.rows.data();
+	for (auto& row: result.rows) {
+		std::fill(std::begin(row.counts), std::end(row.counts), 0);
 	}
 
-	// accumulate queue counters
-	for (const auto& pair: qmap) {
+	auto dst = dest.data();
+	for (size_t i = 0; i < n; ++i) {
+		rows[dst[i] >> 3].counts[dst[i] & 7] += d[i];
+	}
 
-		auto index = pair.first;
-		const auto& entry = pair.second;
-		auto queue = entry.first;
-		auto offset = entry.second;
+	measure_balance(result);
 
-		uint64_t prev = state[index];
-		uint64_t current = stats[index];
+	result.stamp = stamp;
+	result.elapsed = elapsed;
+	result.read_ns = read_time;
+	result.refresh_ns = clock_ns() - start;
+	results.publish();
 
-		// record the difference in value
-		uint64_t delta = (current > prev) ? (current - prev) : 0;
-		qstats[queue].counts[offset] += delta;
+	std::swap(previous, current);
+	front ^= 1;
+}
 
-		// auto-copy into the total if there's no explicit map of total fields
-		if (tmap.size() == 0) {
-			tstats.counts[offset] += delta;
+//
+// a single pass over the queues' packet counts for each direction
+//
+void Interface::measure_balance(result_t& result)
+{
+	auto queues = result.rows.size() - 1;
+	auto rows = result.rows.data() + 1;
+
+	for (size_t k = 0; k < 2; ++k) {
+		auto& b = result.balance[k];
+		b = balance_t { };
+
+		size_t n = 0;
+		double sum = 0, sumsq = 0;
+		uint64_t max = 0;
+
+		for (size_t q = 0; q < queues; ++q) {
+			if (!rows[q].has(k)) continue;
+
+			auto v = rows[q].counts[k];
+			++n;
+			sum += v;
+			sumsq += static_cast<double>(v) * v;
+			b.idle += (v == 0);
+			if (v > max) {
+				max = v;
+				b.hottest = q;
+			}
+		}
+
+		if (n < 2) continue;
+		b.valid = true;
+
+		if (sum > 0) {
+			auto mean = sum / n;
+			b.ratio = max / mean;
+			b.cv = std::sqrt(std::max(sumsq / n - mean * mean, 0.0)) / mean;
+		} else {
+			b.idle = 0;
 		}
 	}
+}
+
+void Interface::detach()
+{
+	_detached = true;
+}
+
+bool Interface::detached() const
+{
+	return _detached;
+}
+
+bool Interface::acquire()
+{
+	return results.acquire();
+}
+
+uint64_t Interface::timestamp() const
+{
+	return results.front().stamp;
+}
+
+double Interface::interval() const
+{
+	return results.front().elapsed / 1e9;
+}
+
+uint64_t Interface::interval_ns() const
+{
+	return results.front().elapsed;
+}
+
+uint64_t Interface::read_ns() const
+{
+	return results.front().read_ns;
+}
+
+uint64_t Interface::refresh_ns() const
+{
+	return results.front().refresh_ns;
+}
 
-	std::swap(stats, state);
+const std::vector<uint32_t>& Interface::potential() const
+{
+	return reach;
 }
 
 size_t Interface::queue_count() const
 {
-	return qstats.size();
+	return results.front().rows.size() - 1;
 }
 
 const Interface::ifstats_t& Interface::queue_stats(size_t n) const
 {
-	return qstats[n];
+	return results.front().rows[n + 1];
 }
 
 const Interface::ifstats_t& Interface::total_stats() const
 {
-	return tstats;
+	return results.front().rows[0];
 }
 
-size_t get_offset(bool rx, bool bytes)
+const Interface::balance_t& Interface::balance(bool rx) const
 {
-	return rx + 2 * bytes;
+	return results.front().balance[rx];
 }
 
-void Interface::build_stats_map(StringsetParser* parser)
+//
+// (re)build the tables that map the NIC's stats to the totals and queue
+// rows, seeding the previous values from `state`
+//
+void Interface::build_stats_map(const StatsSource::snapshot_t& state)
 {
+	// the generation first, so that a change during the build is noticed
+	generation = source->generation();
+	nstats = state.size();
+
+	// find the right code to parse this NIC's stats output
+	auto info = source->driver() + ":" + _name;
+
+	auto parser_name = source->parser();
+	auto parser = StringsetParser::find(parser_name);
+	if (!parser) {
+		if (!generic) {
+			throw std::runtime_error("Unsupported NIC driver " + info);
+		}
+
+		parser_name = "generic";
+		parser = StringsetParser::find(parser_name);
+		if (!parser) {
+			throw std::runtime_error("Failed fallback from " + info + " to generic");
+		}
+	}
+
+	// stats entry number -> offset, for totals
+	std::vector<std::pair<size_t, size_t>> tmap;
+	bool has_totals = false, has_drop_totals = false;
+
+	// stats entry number -> (queue, offset), for queues
+	std::vector<std::pair<size_t, std::pair<size_t, size_t>>> qmap;
+
 	size_t qcount = 0;
-	auto names = ethtool->stringset(ETH_SS_STATS);
+	watch.clear();
 
-	//
-	// iterate through all of the stats looking for names that
-	// match the recognised strings
-	//
-	for (size_t i = 0, n = names.size(); i < n; ++i) {
+	// the queues' counters, including the idle ones, by queue and offset
+	std::vector<std::pair<size_t, size_t>> possible;
 
-		size_t queue = -1;
-		auto rx = false;
-		auto bytes = false;
+	auto names = source->stringset(ETH_SS_STATS);
 
-		//
-		// try to map the stringset entry to a NIC total
-		//
-		bool total_found = parser->match_total(names[i], state[i], rx, bytes);
-		if (total_found) {
-			// save offset into the four entry structure
-			tmap[i] = get_offset(rx, bytes);
+	// find (or build) the map for this string set
+	auto map = StatsMap::get(parser, parser_name, source->driver(),
+				 source->version(), names, state);
+
+	for (const auto& entry: *map) {
+
+		auto i = entry.index;
+		if (i >= state.size()) {
+			continue;
 		}
 
-		//
-		// try to map the stringset entry to a queue - pass the initially
-		// read value too, for those drivers (e.g. vmxnet3) that store the
-		// queue number in a key-value pair
-		//
-		bool queue_found = parser->match_queue(names[i], state[i], rx, bytes, queue);
+		if (entry.total >= 0) {
+			tmap.emplace_back(i, entry.total);
+			(is_drop(entry.total) ? has_drop_totals : has_totals) = true;
+		}
 
 		//
-		// remember the individual rows that make up the four stats
-		// values for each NIC queue
+		// remember the individual rows that make up the stats values
+		// for each NIC queue - drop counters are legitimately zero, so
+		// don't count towards the number of queues, and are only kept
+		// for queues that have throughput counters
 		//
-		if (queue_found && (state[i] > 0)) {	// ignore zero-counters
-
-			// calculate offset into the four entry structure
-			auto offset = get_offset(rx, bytes);
+		if (entry.queue >= 0) {
+			possible.emplace_back(entry.queue, entry.offset);
+		}
 
-			// and populate it
-			qmap[i] = queue_entry_t { queue, offset };
+		if (entry.queue >= 0 && is_drop(entry.offset)) {
+			qmap.emplace_back(i, std::make_pair(entry.queue, entry.offset));
+		} else if (entry.queue >= 0 && state[i] == 0) {
+			// ignore zero-counters, but notice if they become active
+			watch.push_back(i);
+		} else if (entry.queue >= 0) {
+			size_t queue = entry.queue;
+			qmap.emplace_back(i, std::make_pair(queue, entry.offset));
 
 			// count the number of queues
 			qcount = std::max(queue + 1, qcount);
 		}
 	}
 
-	qstats.resize(qcount);
+	// row 0 is the total, queue `n` is row `n + 1`
+	std::vector<ifstats_t> rows(qcount + 1, ifstats_t { });
+
+	std::vector<std::pair<uint32_t, uint32_t>> entries;
+	auto add = [&](size_t index, size_t row, size_t offset) {
+		entries.emplace_back(index, (row << 3) | offset);
+		rows[row].present |= (1U << offset);
+	};
+
+	for (const auto& entry: tmap) {
+		add(entry.first, 0, entry.second);
+	}
+
+	for (const auto& entry: qmap) {
+		auto queue = entry.second.first;
+		auto offset = entry.second.second;
+		if (queue >= qcount) continue;
+
+		add(entry.first, queue + 1, offset);
+
+		// auto-copy into the total if there's no explicit map of total fields of that kind
+		if (!(is_drop(offset) ? has_drop_totals : has_totals)) {
+			add(entry.first, 0, offset);
+		}
+	}
+
+	reach.assign(rows.size(), 0);
+	for (size_t row = 0; row < rows.size(); ++row) {
+		reach[row] = rows[row].present;
+	}
+
+	for (const auto& entry: possible) {
+		auto queue = entry.first;
+		auto offset = entry.second;
+
+		if (queue + 1 >= reach.size()) {
+			reach.resize(queue + 2, 0);
+		}
+		reach[queue + 1] |= (1U << offset);
+		if (!(is_drop(offset) ? has_drop_totals : has_totals)) {
+			reach[0] |= (1U << offset);
+		}
+	}
+
+	layout.swap(rows);
+	++layout_id;
+
+	// sort the tables into stats order for sequential reads
+	std::stable_sort(entries.begin(), entries.end(),
+		[](const std::pair<uint32_t, uint32_t>& a, const std::pair<uint32_t, uint32_t>& b) {
+			return a.first < b.first;
+		});
+
+	gather.clear();
+	dest.clear();
+	for (const auto& entry: entries) {
+		gather.push_back(entry.first);
+		dest.push_back(entry.second);
+	}
+
+	// seed the previous values from the initial read
+	previous.resize(gather.size());
+	current.resize(gather.size());
+	delta.resize(gather.size());
+	for (size_t i = 0; i < gather.size(); ++i) {
+		previous[i] = state[gather[i]];
+	}
 }
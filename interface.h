@@ -13,58 +13,195 @@
 
 #include <string>
 #include <vector>
-#include <map>
+#include <memory>
+#include <cstdint>
 
-#include "ethtool++.h"
+#include "source.h"
 #include "parser.h"
-#include "optval.h"
+#include "tribuf.h"
 
 class Interface {
 
 public:
 	//
-	// the four combinations of rx/tx and packets/bytes
-	// are stored in this structure thus:
+	// the four combinations of rx/tx and packets/bytes,
+	// and the packets dropped in each direction, are
+	// stored in this structure thus:
 	//   0 : tx packets
 	//   1 : rx packets
 	//   2 : tx bytes
 	//   3 : rx bytes
+	//   4 : tx drops
+	//   5 : rx drops
 	//
-	typedef struct {
-		OptVal			counts[4];
-	} ifstats_t;
+	// `present` has a bit set for each of those values
+	// that the NIC actually supplies
+	//
+	struct ifstats_t {
+		uint64_t		counts[6];
+		uint32_t		present;
+
+		bool has(size_t n) const {
+			return present & (1U << n);
+		}
+	};
+
+	//
+	// how evenly one direction's packets were spread over the queues
+	// in a sample - only `valid` if the NIC has at least two queues
+	// that supply that counter
+	//
+	struct balance_t {
+		bool			valid;
+		double			ratio;		// busiest queue / mean
+		double			cv;		// coefficient of variation
+		uint32_t		hottest;	// the busiest queue
+		uint32_t		idle;		// queues with no packets while others had some
+	};
 
 private:
-	// index to queue table, offset to value within
-	typedef std::pair<size_t, size_t> queue_entry_t;
+	//
+	// the results of one refresh - row 0 holds the NIC totals and
+	// the remaining rows hold each queue's values
+	//
+	struct result_t {
+		uint64_t		stamp = 0;	// ns, CLOCK_MONOTONIC
+		uint64_t		elapsed = 0;	// ns since previous sample
+		std::vector<ifstats_t>	rows;
+		balance_t		balance[2] = { };	// tx, rx
+		uint32_t		layout = 0;	// as per Interface::layout_id
 
-	// string entry number -> queue_entry_t
-	typedef std::map<size_t, queue_entry_t> queue_map_t;
-	typedef std::map<size_t, size_t>	total_map_t;
+		// ns spent reading the counters, and in the whole refresh
+		uint64_t		read_ns = 0;
+		uint64_t		refresh_ns = 0;
+	};
+
+	//
+	// flat tables describing the mapped stats, sorted by their
+	// index in the NIC's stats table - entry `i` reads stat
+	// `gather[i]` and adds its delta to the value at row
+	// `dest[i] >> 3`, offset `dest[i] & 7`
+	//
+	std::vector<uint32_t>		gather;
+	std::vector<uint32_t>		dest;
+
+	//
+	// the stats that the map was built for - the map is rebuilt if
+	// the source's string set changes (e.g. after `ethtool -L`), or
+	// if any of the `watch` stats, which are queue counters that were
+	// left out because they were zero, becomes non-zero
+	//
+	size_t				nstats = 0;
+	uint32_t			generation = 0;
+	std::vector<uint32_t>		watch;
+
+	//
+	// the rows that the map produces, which are copied into each
+	// result buffer in turn as it's next used after a rebuild
+	//
+	std::vector<ifstats_t>		layout;
+	uint32_t			layout_id = 0;
+
+	//
+	// the counters that the map could produce in each row, including
+	// those of the queues that are idle for now
+	//
+	std::vector<uint32_t>		reach;
+
+	// the previous and current values and the deltas of just
+	// the mapped stats, indexed as above
+	std::vector<uint64_t>		previous;
+	std::vector<uint64_t>		current;
+	std::vector<uint64_t>		delta;
 
 private:
 	std::string			_name;
-	Ethtool*			ethtool = nullptr;
-	Ethtool::stats_t		state;
+	std::string			_driver;
+	bool				generic;
+	bool				_detached = false;
+	std::unique_ptr<StatsSource>	source;
+
+	// double-buffered raw snapshots - refresh() fills the back
+	// one and then flips, so the front is always the latest
+	// complete set of counter values
+	StatsSource::snapshot_t		snaps[2];
+	size_t				front = 0;
 
-	ifstats_t			tstats;
-	std::vector<ifstats_t>		qstats;
+	uint64_t			stamp = 0;	// ns, CLOCK_MONOTONIC
+	uint64_t			elapsed = 0;	// ns since previous sample
+	uint64_t			read_time = 0;	// ns taken by the read
 
-	total_map_t			tmap;
-	queue_map_t			qmap;
+	//
+	// results are handed from whichever thread calls refresh()
+	// to the display thread without locking
+	//
+	TripleBuffer<result_t>		results;
 
 private:
-	void				build_stats_map(StringsetParser *parser);
+	void				build_stats_map(const StatsSource::snapshot_t& state);
+	bool				reconfigured(const StatsSource::snapshot_t& state);
+	bool				sample(StatsSource::snapshot_t& snap);
+	void				measure_balance(result_t& result);
 
 public:
-	Interface(const std::string& name, bool generic = false);
+	//
+	// where a NIC's counters are read from - its driver's ethtool
+	// stats, the netdev netlink per-queue stats, or just the totals
+	// from the ethtool netlink MAC stats or the kernel's link stats
+	//
+	enum source_t { ETHTOOL, NETDEV_NETLINK, ETHTOOL_NETLINK, LINK_STATS };
+
+	Interface(const std::string& name, bool generic = false, source_t from = ETHTOOL);
+
+	// use the given source (e.g. a Simulator), taking ownership of it
+	Interface(const std::string& name, StatsSource* source, bool generic = false);
 	~Interface();
 
 public:
-	const std::string		name() const;
+	const std::string&		name() const;
+	const std::string&		driver() const;
+
+	//
+	// sampling side - refresh() must not be called concurrently
+	// for the same interface
+	//
+	// if the NIC's queues or stats have changed since the previous
+	// call the stats map is rebuilt, and as there are no deltas to
+	// show for that sample nothing new is published
+	//
 	void				refresh();
 
+	//
+	// stop sampling a NIC that has gone away, leaving its last results
+	// in place - NB: not while refresh() may be running
+	//
+	void				detach();
+	bool				detached() const;
+
+	//
+	// the counters that each row could have as the NIC's queues become
+	// active, as of the latest rebuild of the stats map - NB: only valid
+	// on the thread that calls refresh()
+	//
+	const std::vector<uint32_t>&	potential() const;
+
+	//
+	// display side - acquire() picks up the most recent published
+	// results, which the remaining functions then return
+	//
+	bool				acquire();
+
+	// time of the most recent sample, and seconds since the one before
+	uint64_t			timestamp() const;
+	double				interval() const;
+	uint64_t			interval_ns() const;
+
+	// the time taken to read the counters, and by the whole refresh
+	uint64_t			read_ns() const;
+	uint64_t			refresh_ns() const;
+
 	size_t				queue_count() const;
 	const ifstats_t&		queue_stats(size_t n) const;
 	const ifstats_t&		total_stats() const;
+	const balance_t&		balance(bool rx) const;
 };
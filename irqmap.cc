@@ -0,0 +1,449 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <set>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "irqmap.h"
+#include "interface.h"
+#include "util.h"
+
+static std::string read_line(const std::string& path)
+{
+	std::ifstream in(path);
+	std::string line;
+	std::getline(in, line);
+	return line;
+}
+
+static std::vector<std::string> list_dir(const std::string& path)
+{
+	std::vector<std::string> names;
+	if (auto dir = opendir(path.c_str())) {
+		while (auto ent = readdir(dir)) {
+			if (ent->d_name[0] != '.') {
+				names.push_back(ent->d_name);
+			}
+		}
+		closedir(dir);
+	}
+	return names;
+}
+
+// e.g. "0-3,8,10-11"
+static std::vector<int> parse_cpulist(const std::string& list)
+{
+	std::vector<int> cpus;
+	auto p = list.c_str();
+
+	while (isdigit(*p)) {
+		char *end;
+		int lo = strtol(p, &end, 10);
+		int hi = lo;
+		if (*end == '-') {
+			hi = strtol(end + 1, &end, 10);
+		}
+		for (int cpu = lo; cpu <= hi; ++cpu) {
+			cpus.push_back(cpu);
+		}
+		p = (*end == ',') ? end + 1 : end;
+	}
+
+	return cpus;
+}
+
+// the lowest CPU in a hex mask, e.g. "00000000,00000010" -> 4
+static int first_cpu_in_mask(const std::string& mask)
+{
+	int bit = 0;
+	for (auto i = mask.rbegin(); i != mask.rend(); ++i) {
+		if (*i == ',') continue;
+		if (!isxdigit(*i)) return -1;
+
+		auto nibble = isdigit(*i) ? *i - '0' : tolower(*i) - 'a' + 10;
+		for (int b = 0; b < 4; ++b, ++bit) {
+			if (nibble & (1 << b)) return bit;
+		}
+	}
+	return -1;
+}
+
+//
+// the queue number at the end of an interrupt's name, ignoring the
+// interface's own name, any "@pci:..." suffix, and the names of
+// interrupts that are used for something other than the queues
+//
+static long queue_number(std::string action, const std::string& ifname)
+{
+	static const char* others[] = {
+		"async", "config", "ctrl", "cmd", "misc", "mgmt", "event", "pages"
+	};
+
+	action = action.substr(0, action.find('@'));
+	for (auto other: others) {
+		if (action.find(other) != std::string::npos) return -1;
+	}
+
+	for (size_t pos; (pos = action.find(ifname)) != std::string::npos; ) {
+		action.erase(pos, ifname.size());
+	}
+
+	auto start = action.size();
+	while (start > 0 && isdigit(action[start - 1])) --start;
+	if (start == action.size()) {
+		return -1;
+	}
+
+	return strtol(action.c_str() + start, nullptr, 10);
+}
+
+// parse a decimal number, stopping at `end`
+static const char* parse_u64(const char* p, const char* end, uint64_t& n)
+{
+	while (p < end && *p == ' ') ++p;
+	n = 0;
+	while (p < end && *p >= '0' && *p <= '9') {
+		n = n * 10 + (*p++ - '0');
+	}
+	return p;
+}
+
+IrqMap::IrqMap(const std::vector<std::shared_ptr<Interface>>& ifaces)
+	: ifaces(ifaces)
+{
+	irq_fd = open("/proc/interrupts", O_RDONLY | O_CLOEXEC);
+	if (irq_fd < 0) {
+		throw_errno("open(/proc/interrupts)");
+	}
+
+	softirq_fd = open("/proc/softirqs", O_RDONLY | O_CLOEXEC);
+	if (softirq_fd < 0) {
+		close(irq_fd);
+		throw_errno("open(/proc/softirqs)");
+	}
+
+	buf.resize(64 * 1024);
+	map();
+}
+
+IrqMap::~IrqMap()
+{
+	close(irq_fd);
+	close(softirq_fd);
+}
+
+//
+// (re)build the whole mapping, and read the initial counts
+//
+void IrqMap::map()
+{
+	// CPU -> NUMA node
+	std::vector<int> cpu_nodes;
+	for (const auto& node: list_dir("/sys/devices/system/node")) {
+		if (node.compare(0, 4, "node") || !isdigit(node[4])) continue;
+		for (auto cpu: parse_cpulist(read_line("/sys/devices/system/node/" + node + "/cpulist"))) {
+			if (cpu_nodes.size() <= static_cast<size_t>(cpu)) {
+				cpu_nodes.resize(cpu + 1, -1);
+			}
+			cpu_nodes[cpu] = atoi(node.c_str() + 4);
+		}
+	}
+
+	// IRQ -> name, which is the last word on the line
+	std::map<unsigned, std::string> actions;
+	{
+		std::ifstream in("/proc/interrupts");
+		std::string line;
+		while (std::getline(in, line)) {
+			auto p = line.c_str();
+			while (*p == ' ') ++p;
+			if (!isdigit(*p)) continue;
+
+			auto irq = strtoul(p, nullptr, 10);
+			auto last = line.find_last_of(' ');
+			if (last != std::string::npos && last + 1 < line.size()) {
+				actions[irq] = line.substr(last + 1);
+			}
+		}
+	}
+
+	nics.assign(ifaces.size(), nic_t());
+	unsigned max_irq = 0;
+
+	for (size_t i = 0; i < ifaces.size(); ++i) {
+		auto& nic = nics[i];
+		auto& name = ifaces[i]->name();
+		auto dev = "/sys/class/net/" + name + "/device";
+
+		//
+		// a virtual device (e.g. virtio) sits under the PCI device
+		// that has the interrupts
+		//
+		std::set<unsigned> irqs;
+		for (auto dir: { dev, dev + "/.." }) {
+			for (const auto& irq: list_dir(dir + "/msi_irqs")) {
+				irqs.insert(strtoul(irq.c_str(), nullptr, 10));
+			}
+
+			auto node = read_line(dir + "/numa_node");
+			if (nic.node < 0 && !node.empty()) {
+				nic.node = atoi(node.c_str());
+			}
+
+			if (!irqs.empty()) break;
+		}
+
+		nic.queues.resize(ifaces[i]->queue_count());
+
+		for (const auto& action: actions) {
+			auto irq = action.first;
+			bool mine = irqs.empty() ? action.second.find(name + "-") != std::string::npos
+						 : irqs.count(irq) > 0;
+			if (!mine) continue;
+
+			auto q = queue_number(action.second, name);
+			if (q < 0 || static_cast<size_t>(q) >= nic.queues.size()) continue;
+
+			nic.queues[q].irqs.push_back(irq);
+			nic.rate = 0;
+			max_irq = std::max(max_irq, irq);
+		}
+
+		for (size_t q = 0; q < nic.queues.size(); ++q) {
+			auto& queue = nic.queues[q];
+
+			if (!queue.irqs.empty()) {
+				auto irq = "/proc/irq/" + std::to_string(queue.irqs[0]);
+				auto cpus = parse_cpulist(read_line(irq + "/effective_affinity_list"));
+				if (cpus.empty()) {
+					cpus = parse_cpulist(read_line(irq + "/smp_affinity_list"));
+				}
+				if (!cpus.empty()) {
+					queue.cpu = cpus[0];
+				}
+			} else {
+				auto xps = "/sys/class/net/" + name + "/queues/tx-" + std::to_string(q) + "/xps_cpus";
+				queue.cpu = first_cpu_in_mask(read_line(xps));
+			}
+
+			if (queue.cpu >= 0 && static_cast<size_t>(queue.cpu) < cpu_nodes.size()) {
+				queue.node = cpu_nodes[queue.cpu];
+			}
+			queue.remote = (nic.node >= 0 && queue.node >= 0 && queue.node != nic.node);
+		}
+	}
+
+	// give each of the interrupts a counter
+	slots.assign(max_irq + 1, -1);
+	int nslots = 0;
+	for (auto& nic: nics) {
+		for (auto& queue: nic.queues) {
+			for (auto irq: queue.irqs) {
+				if (slots[irq] < 0) {
+					slots[irq] = nslots++;
+				}
+			}
+		}
+	}
+
+	counts[0].assign(nslots, 0);
+	counts[1].assign(nslots, 0);
+
+	read_interrupts(counts[cur]);
+	read_softirqs(softirqs[cur]);
+	stamp = clock_ns();
+}
+
+//
+// read the whole of a /proc file into `buf`, which only grows if the
+// file no longer fits
+//
+size_t IrqMap::read_all(int fd)
+{
+	while (true) {
+		size_t len = 0;
+		while (len < buf.size()) {
+			auto res = pread(fd, buf.data() + len, buf.size() - len, len);
+			if (res < 0) {
+				if (errno == EINTR) continue;
+				throw_errno("pread");
+			} else if (res == 0) {
+				return len;
+			}
+			len += res;
+		}
+		buf.resize(buf.size() * 2);
+	}
+}
+
+//
+// sum the per-CPU counts of the interrupts of interest, which are
+// lines of the form "  NN:   count count ...   chip  name"
+//
+void IrqMap::read_interrupts(std::vector<uint64_t>& out)
+{
+	auto len = read_all(irq_fd);
+	const char* p = buf.data();
+	auto end = p + len;
+
+	// the header has one column per online CPU
+	auto eol = static_cast<const char*>(memchr(p, '\n', len));
+	if (!eol) return;
+
+	size_t ncpus = 0;
+	for (auto s = p; s + 3 <= eol; ++s) {
+		if (s[0] == 'C' && s[1] == 'P' && s[2] == 'U') ++ncpus;
+	}
+
+	for (p = eol + 1; p < end; p = eol + 1) {
+		eol = static_cast<const char*>(memchr(p, '\n', end - p));
+		if (!eol) eol = end;
+
+		uint64_t irq;
+		auto s = parse_u64(p, eol, irq);
+		if (s == eol || *s != ':' || irq >= slots.size() || slots[irq] < 0) {
+			continue;
+		}
+
+		uint64_t sum = 0;
+		++s;
+		for (size_t c = 0; c < ncpus; ++c) {
+			uint64_t n;
+			s = parse_u64(s, eol, n);
+			sum += n;
+		}
+		out[slots[irq]] = sum;
+	}
+}
+
+//
+// the NET_TX and NET_RX lines, with one column per online CPU, by number
+//
+void IrqMap::read_softirqs(std::vector<uint64_t>& out)
+{
+	auto len = read_all(softirq_fd);
+	const char* p = buf.data();
+	auto end = p + len;
+
+	auto eol = static_cast<const char*>(memchr(p, '\n', len));
+	if (!eol) return;
+
+	// the CPU numbers of the columns, which skip any offline CPUs
+	columns.clear();
+	for (auto s = p; s + 3 <= eol; ++s) {
+		if (s[0] == 'C' && s[1] == 'P' && s[2] == 'U') {
+			uint64_t cpu;
+			s = parse_u64(s + 3, eol, cpu) - 1;
+			columns.push_back(cpu);
+			if (out.size() <= cpu) {
+				out.resize(cpu + 1);
+			}
+		}
+	}
+	std::fill(out.begin(), out.end(), 0);
+
+	for (p = eol + 1; p < end; p = eol + 1) {
+		eol = static_cast<const char*>(memchr(p, '\n', end - p));
+		if (!eol) eol = end;
+
+		while (p < eol && *p == ' ') ++p;
+		if (eol - p < 7 || (memcmp(p, "NET_TX:", 7) && memcmp(p, "NET_RX:", 7))) {
+			continue;
+		}
+
+		auto s = p + 7;
+		for (auto cpu: columns) {
+			uint64_t n;
+			s = parse_u64(s, eol, n);
+			out[cpu] += n;
+		}
+	}
+}
+
+void IrqMap::refresh()
+{
+	// a NIC's queues have changed, so its interrupts probably have too
+	for (size_t i = 0; i < ifaces.size(); ++i) {
+		if (ifaces[i]->queue_count() != nics[i].queues.size()) {
+			map();
+			return;
+		}
+	}
+
+	auto next = cur ^ 1;
+	read_interrupts(counts[next]);
+	read_softirqs(softirqs[next]);
+
+	auto now = clock_ns();
+	auto secs = (now - stamp) / 1e9;
+	stamp = now;
+
+	auto delta = [](uint64_t c, uint64_t p) {
+		return (c > p) ? c - p : 0;
+	};
+
+	for (auto& nic: nics) {
+		if (nic.rate < 0) continue;
+
+		nic.rate = 0;
+		for (auto& queue: nic.queues) {
+			uint64_t n = 0;
+			for (auto irq: queue.irqs) {
+				auto slot = slots[irq];
+				n += delta(counts[next][slot], counts[cur][slot]);
+			}
+			queue.rate = n / secs;
+			nic.rate += queue.rate;
+		}
+	}
+
+	auto& c = softirqs[next];
+	auto& p = softirqs[cur];
+	softirq_rates.resize(c.size());
+	for (size_t cpu = 0; cpu < c.size(); ++cpu) {
+		softirq_rates[cpu] = delta(c[cpu], cpu < p.size() ? p[cpu] : c[cpu]) / secs;
+	}
+
+	cur = next;
+}
+
+int IrqMap::node(size_t nic) const
+{
+	return nic < nics.size() ? nics[nic].node : -1;
+}
+
+double IrqMap::rate(size_t nic) const
+{
+	return nic < nics.size() ? nics[nic].rate : -1;
+}
+
+const IrqMap::queue_t* IrqMap::queue(size_t nic, size_t q) const
+{
+	if (nic >= nics.size() || q >= nics[nic].queues.size()) {
+		return nullptr;
+	}
+
+	auto& queue = nics[nic].queues[q];
+	return (queue.cpu >= 0 || !queue.irqs.empty()) ? &queue : nullptr;
+}
+
+double IrqMap::softirq_rate(int cpu) const
+{
+	return (cpu >= 0 && static_cast<size_t>(cpu) < softirq_rates.size()) ? softirq_rates[cpu] : 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Interface;
+
+//
+// maps each NIC's queues to their interrupts, and those to the CPUs
+// that handle them and the CPUs' NUMA nodes, and samples the rate of
+// those interrupts and of each CPU's network softirqs
+//
+// the mapping is found at startup, and again whenever a NIC's number
+// of queues changes - a NIC's interrupts are
+// those of its PCI device (from sysfs) or failing that those named
+// after the interface, and each interrupt's queue is the number at
+// the end of its name (e.g. "eth0-TxRx-3", "mlx5_comp3@pci:...",
+// "virtio0-input.3"), with a queue that has no interrupt of its own
+// falling back to the first CPU of its transmit packet steering map
+//
+// the counters are read each tick from /proc/interrupts and
+// /proc/softirqs, using persistent file descriptors and buffers
+//
+class IrqMap {
+
+public:
+	struct queue_t {
+		std::vector<unsigned>	irqs;
+		int			cpu = -1;
+		int			node = -1;
+		bool			remote = false;	// not on the NIC's node
+		double			rate = 0;	// interrupts/s
+	};
+
+private:
+	const std::vector<std::shared_ptr<Interface>>&	ifaces;
+
+	struct nic_t {
+		int			node = -1;
+		double			rate = -1;	// interrupts/s, all queues, or -1 if none are mapped
+		std::vector<queue_t>	queues;
+	};
+
+	std::vector<nic_t>		nics;
+
+	// IRQ number -> counter slot, or -1 if not of interest
+	std::vector<int>		slots;
+	std::vector<uint64_t>		counts[2];
+
+	// CPU number -> NET_TX + NET_RX softirqs, and their rate
+	std::vector<uint64_t>		softirqs[2];
+	std::vector<double>		softirq_rates;
+	std::vector<int>		columns;
+
+	size_t				cur = 0;
+	uint64_t			stamp = 0;
+
+	int				irq_fd = -1;
+	int				softirq_fd = -1;
+	std::vector<char>		buf;
+
+	void				map();
+	size_t				read_all(int fd);
+	void				read_interrupts(std::vector<uint64_t>& out);
+	void				read_softirqs(std::vector<uint64_t>& out);
+
+public:
+	IrqMap(const std::vector<std::shared_ptr<Interface>>& ifaces);
+	~IrqMap();
+
+	// read the counters, and work out the rates since the last call
+	void				refresh();
+
+	// the NIC's NUMA node and its interrupts/s, or -1 if unknown
+	int				node(size_t nic) const;
+	double				rate(size_t nic) const;
+
+	// the given queue's mapping, or nullptr if there isn't one
+	const queue_t*			queue(size_t nic, size_t q) const;
+
+	// NET_TX plus NET_RX softirqs/s on the CPU
+	double				softirq_rate(int cpu) const;
+};
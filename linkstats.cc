@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+#include <net/if.h>
+#include <linux/if_link.h>
+#include <linux/rtnetlink.h>
+
+#include "linkstats.h"
+#include "ethtool++.h"
+#include "netlink.h"
+#include "util.h"
+
+//
+// the synthesized stats strings, in the generic driver's format,
+// and the fields of rtnl_link_stats64 that supply their values
+//
+static const char* names[] = {
+	"tx_packets", "rx_packets", "tx_bytes", "rx_bytes",
+	"tx_dropped", "rx_dropped", "rx_missed_errors"
+};
+
+static const size_t offsets[] = {
+	offsetof(rtnl_link_stats64, tx_packets),
+	offsetof(rtnl_link_stats64, rx_packets),
+	offsetof(rtnl_link_stats64, tx_bytes),
+	offsetof(rtnl_link_stats64, rx_bytes),
+	offsetof(rtnl_link_stats64, tx_dropped),
+	offsetof(rtnl_link_stats64, rx_dropped),
+	offsetof(rtnl_link_stats64, rx_missed_errors),
+};
+
+static const size_t count = sizeof(names) / sizeof(names[0]);
+
+namespace {
+
+struct entry_t {
+	std::vector<__u64>	values = std::vector<__u64>(count);
+	bool			seen = false;
+};
+
+}
+
+class LinkStats::Batch : public NetlinkDump<entry_t> {
+
+private:
+	NetlinkMessage		request();
+	void			parse(const nlmsghdr* nlh);
+
+public:
+	Batch();
+};
+
+LinkStats::Batch::Batch()
+	: NetlinkDump(NETLINK_ROUTE)
+{
+}
+
+void LinkStats::Batch::parse(const nlmsghdr* nlh)
+{
+	if (nlh->nlmsg_type != RTM_NEWSTATS || nlh->nlmsg_len < NLMSG_LENGTH(sizeof(if_stats_msg))) {
+		return;
+	}
+
+	// skip interfaces we're not monitoring
+	auto ifsm = static_cast<const if_stats_msg*>(NLMSG_DATA(nlh));
+	auto entry = slot(ifsm->ifindex);
+	if (!entry) {
+		return;
+	}
+
+	auto offset = NLMSG_ALIGN(sizeof(if_stats_msg));
+	auto attrs = reinterpret_cast<const char*>(ifsm) + offset;
+
+	NetlinkAttrs(attrs, nlh->nlmsg_len - NLMSG_LENGTH(offset)).each([&](uint16_t type, const nlattr* a) {
+		if (type != IFLA_STATS_LINK_64) return;
+
+		// older kernels have a shorter struct, newer ones a longer one
+		rtnl_link_stats64 stats = { };
+		memcpy(&stats, NetlinkAttrs::data(a), std::min(NetlinkAttrs::size(a), sizeof stats));
+
+		auto base = reinterpret_cast<const char*>(&stats);
+		for (size_t i = 0; i < count; ++i) {
+			memcpy(&entry->values[i], base + offsets[i], sizeof(__u64));
+		}
+
+		entry->seen = true;
+	});
+}
+
+NetlinkMessage LinkStats::Batch::request()
+{
+	NetlinkMessage msg(RTM_GETSTATS, NLM_F_DUMP);
+
+	if_stats_msg ifsm = { };
+	ifsm.family = AF_UNSPEC;
+	ifsm.filter_mask = IFLA_STATS_FILTER_BIT(IFLA_STATS_LINK_64);
+	msg.put(&ifsm, sizeof ifsm);
+
+	return msg;
+}
+
+LinkStats::LinkStats(const std::string& ifname)
+	: _name(ifname)
+{
+	ifindex = if_nametoindex(ifname.c_str());
+	if (!ifindex) {
+		throw_errno("if_nametoindex(" + ifname + ")");
+	}
+
+	// not every software interface has driver details
+	try {
+		Ethtool ethtool(ifname);
+		_driver = ethtool.driver();
+		_version = ethtool.version();
+	} catch (const std::exception&) {
+		_driver = "unknown";
+	}
+
+	batch = shared_dump<Batch>();
+	batch->add(ifindex);
+	if (!batch->supported(ifindex)) {
+		batch->remove(ifindex);
+		throw std::runtime_error("no rtnetlink link stats for " + _driver + ":" + ifname);
+	}
+}
+
+LinkStats::~LinkStats()
+{
+	batch->remove(ifindex);
+}
+
+LinkStats::stringset_t LinkStats::stringset(ethtool_stringset ss)
+{
+	stringset_t result;
+	if (ss == ETH_SS_STATS) {
+		result.assign(names, names + count);
+	}
+	return result;
+}
+
+void LinkStats::stats(snapshot_t& snap)
+{
+	_stamp = batch->get(ifindex, [&](entry_t& entry) {
+		snap.resize(count);
+		std::copy(entry.values.begin(), entry.values.end(), snap.data());
+	});
+}
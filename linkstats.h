@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "source.h"
+
+//
+// reads the kernel's own 64-bit link counters (rtnl_link_stats64) via
+// rtnetlink instead of the driver's private ethtool stats, so that any
+// interface has totals, including software ones (veth, bridge, bond,
+// tun, vlan...) that have no ethtool stats at all
+//
+// as with EthtoolNetlink, all instances share a single socket, and one
+// RTM_GETSTATS dump per tick retrieves the counters for every interface
+// - the first interface to ask for its stats in a tick triggers the
+// dump, and the others consume the values it already fetched, along
+// with the timestamp of that dump
+//
+// only totals are available this way, there are no per-queue stats
+//
+class LinkStats : public StatsSource {
+
+public:
+	class Batch;
+
+private:
+	Batch*			batch;
+
+	std::string		_name;
+	int			ifindex;
+	std::string		_driver;
+	std::string		_version;
+	uint64_t		_stamp = 0;
+
+public:
+				LinkStats(const std::string& ifname);
+				~LinkStats();
+
+public:
+	stringset_t		stringset(ethtool_stringset);
+	void			stats(snapshot_t& snap);
+	uint64_t		stamp()		{ return _stamp; };
+
+	std::string		driver()	{ return _driver; };
+	std::string		version()	{ return _version; };
+	std::string		parser()	{ return "generic"; };
+};
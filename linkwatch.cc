@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <cerrno>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <net/if_arp.h>
+#include <linux/rtnetlink.h>
+
+#include "linkwatch.h"
+#include "util.h"
+
+LinkWatch::LinkWatch()
+	: nl(NETLINK_ROUTE), buf(65536)
+{
+	// subscribe first, so that nothing is missed between the dump and the events
+	fd = ::socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_ROUTE);
+	if (fd < 0) {
+		throw_errno("socket(AF_NETLINK)");
+	}
+
+	sockaddr_nl sa = { };
+	sa.nl_family = AF_NETLINK;
+	sa.nl_groups = RTMGRP_LINK;
+	if (::bind(fd, reinterpret_cast<sockaddr*>(&sa), sizeof sa) < 0) {
+		::close(fd);
+		throw_errno("bind(RTMGRP_LINK)");
+	}
+
+	dump();
+}
+
+LinkWatch::~LinkWatch()
+{
+	::close(fd);
+}
+
+const LinkWatch::links_t& LinkWatch::links() const
+{
+	return _links;
+}
+
+void LinkWatch::dump()
+{
+	_links.clear();
+
+	NetlinkMessage msg(RTM_GETLINK, NLM_F_DUMP);
+	ifinfomsg ifi = { };
+	ifi.ifi_family = AF_UNSPEC;
+	msg.put(&ifi, sizeof ifi);
+
+	nl.request(msg, [&](const nlmsghdr* nlh) {
+		parse(nlh);
+	});
+}
+
+//
+// apply a single RTM_NEWLINK or RTM_DELLINK - a NEWLINK is also sent
+// for every change of state, so most of them change nothing here
+//
+bool LinkWatch::parse(const nlmsghdr* nlh)
+{
+	if ((nlh->nlmsg_type != RTM_NEWLINK && nlh->nlmsg_type != RTM_DELLINK) ||
+	    nlh->nlmsg_len < NLMSG_LENGTH(sizeof(ifinfomsg)))
+	{
+		return false;
+	}
+
+	// bridge port events arrive on the same group
+	auto ifi = static_cast<const ifinfomsg*>(NLMSG_DATA(nlh));
+	if (ifi->ifi_family == AF_BRIDGE) {
+		return false;
+	}
+
+	if (nlh->nlmsg_type == RTM_DELLINK) {
+		return _links.erase(ifi->ifi_index) > 0;
+	}
+
+	if (ifi->ifi_type == ARPHRD_LOOPBACK) {
+		return false;
+	}
+
+	std::string name;
+	NetlinkAttrs(IFLA_RTA(ifi), IFLA_PAYLOAD(nlh)).each([&](uint16_t type, const nlattr* a) {
+		if (type == IFLA_IFNAME) {
+			name = NetlinkAttrs::string(a);
+		}
+	});
+
+	if (name.empty()) {
+		return false;
+	}
+
+	auto& entry = _links[ifi->ifi_index];
+	if (entry == name) {
+		return false;
+	}
+
+	entry = name;
+	return true;
+}
+
+bool LinkWatch::poll()
+{
+	bool changed = false;
+	bool overrun = false;
+
+	while (true) {
+		auto n = ::recv(fd, buf.data(), buf.size(), 0);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			} else if (errno == ENOBUFS) {
+				overrun = true;
+				continue;
+			} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				break;
+			}
+			throw_errno("recv(RTMGRP_LINK)");
+		}
+
+		auto len = static_cast<size_t>(n);
+		for (auto h = reinterpret_cast<const nlmsghdr*>(buf.data());
+		     NLMSG_OK(h, len); h = NLMSG_NEXT(h, len))
+		{
+			changed |= parse(h);
+		}
+	}
+
+	// some events were lost, so start again from a fresh dump
+	if (overrun) {
+		auto previous = _links;
+		dump();
+		changed |= (_links != previous);
+	}
+
+	return changed;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "netlink.h"
+
+//
+// keeps track of the host's network interfaces via rtnetlink
+//
+// the initial set comes from a single RTM_GETLINK dump, and after that
+// the links that appear, disappear or are renamed are followed through
+// the RTMGRP_LINK multicast group, which poll() drains without blocking
+// - if the kernel has to drop any of those events the set is rebuilt
+// with a fresh dump
+//
+// loopback interfaces are left out
+//
+class LinkWatch {
+
+public:
+	// ifindex -> name
+	typedef std::map<int, std::string> links_t;
+
+private:
+	Netlink			nl;
+	int			fd = -1;	// the multicast subscription
+	std::vector<char>	buf;
+	links_t			_links;
+
+	void			dump();
+	bool			parse(const nlmsghdr* nlh);
+
+public:
+	LinkWatch();
+	~LinkWatch();
+
+	const links_t&		links() const;
+
+	// process any pending events, returning true if the set of links changed
+	bool			poll();
+};
@@ -0,0 +1,668 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+
+#include "matcher.h"
+
+//
+// parse tree node
+//
+struct MatcherNode {
+
+	enum type_t {
+		EMPTY, CHAR, CLASS, ANY, BOL, EOL,
+		CAT, ALT, STAR, PLUS, QUEST, GROUP, BACKREF
+	};
+
+	type_t			type = EMPTY;
+	char			c = 0;
+	std::bitset<256>	set;
+	bool			greedy = true;
+	size_t			group = 0;	// GROUP (0 = non-capturing), BACKREF
+	std::vector<MatcherNode> kids;
+
+	MatcherNode(type_t type = EMPTY) : type(type) { };
+};
+
+typedef MatcherNode Node;
+typedef std::vector<std::string> language_t;
+
+class MatcherCompiler {
+
+private:
+	const std::string&	pattern;
+	size_t			pos = 0;
+	size_t			ngroups = 0;
+	Matcher&		m;
+
+	[[noreturn]] void	error(const std::string& what);
+
+	char			peek() const	{ return pos < pattern.size() ? pattern[pos] : 0; };
+	bool			more() const	{ return pos < pattern.size(); };
+
+	Node			parse_alt();
+	Node			parse_cat();
+	Node			parse_repeat();
+	Node			parse_atom();
+	Node			parse_class();
+	Node			parse_escape(bool in_class);
+
+	// back reference elimination
+	static const Node*	find_group(const Node& node, size_t n, bool& repeated, bool in_repeat = false);
+	static const Node*	find_backref(const Node& node);
+	static bool		language(const Node& node, language_t& result);
+	static void		substitute(Node& node, size_t n, const std::string& s);
+	Node			expand(const Node& node);
+
+	size_t			emit(Matcher::op_t op, uint8_t c = 0, uint16_t x = 0, uint16_t y = 0);
+	void			emit(const Node& node);
+
+public:
+	MatcherCompiler(const std::string& pattern, Matcher& m)
+		: pattern(pattern), m(m) { };
+
+	void			compile();
+};
+
+void MatcherCompiler::error(const std::string& what)
+{
+	throw std::invalid_argument("pattern \"" + pattern + "\": " + what);
+}
+
+Node MatcherCompiler::parse_alt()
+{
+	Node first = parse_cat();
+	if (peek() != '|') {
+		return first;
+	}
+
+	Node node(Node::ALT);
+	node.kids.push_back(first);
+	while (peek() == '|') {
+		++pos;
+		node.kids.push_back(parse_cat());
+	}
+	return node;
+}
+
+Node MatcherCompiler::parse_cat()
+{
+	Node node(Node::CAT);
+	while (more() && peek() != '|' && peek() != ')') {
+		node.kids.push_back(parse_repeat());
+	}
+	return node;
+}
+
+Node MatcherCompiler::parse_repeat()
+{
+	Node atom = parse_atom();
+
+	while (true) {
+		Node::type_t type;
+		switch (peek()) {
+			case '*': type = Node::STAR; break;
+			case '+': type = Node::PLUS; break;
+			case '?': type = Node::QUEST; break;
+			case '{': error("counted repetition is not supported");
+			default: return atom;
+		}
+		++pos;
+
+		Node node(type);
+		if (peek() == '?') {
+			node.greedy = false;
+			++pos;
+		}
+		node.kids.push_back(atom);
+		atom = node;
+	}
+}
+
+Node MatcherCompiler::parse_atom()
+{
+	auto c = pattern[pos++];
+
+	switch (c) {
+		case '(': {
+			Node node(Node::GROUP);
+			if (pattern.compare(pos, 2, "?:") == 0) {
+				pos += 2;
+			} else {
+				node.group = ++ngroups;
+				if (ngroups > Matcher::max_groups) {
+					error("too many groups");
+				}
+			}
+			node.kids.push_back(parse_alt());
+			if (peek() != ')') {
+				error("missing )");
+			}
+			++pos;
+			return node;
+		}
+		case '[':
+			return parse_class();
+		case '\\':
+			return parse_escape(false);
+		case '.':
+			return Node(Node::ANY);
+		case '^':
+			return Node(Node::BOL);
+		case '$':
+			return Node(Node::EOL);
+		case '*': case '+': case '?': case ')':
+			error(std::string("unexpected ") + c);
+		default: {
+			Node node(Node::CHAR);
+			node.c = c;
+			return node;
+		}
+	}
+}
+
+Node MatcherCompiler::parse_escape(bool in_class)
+{
+	if (!more()) {
+		error("trailing backslash");
+	}
+
+	auto c = pattern[pos++];
+	Node node(Node::CLASS);
+
+	switch (c) {
+		case 'd': case 'D':
+			for (int i = '0'; i <= '9'; ++i) node.set.set(i);
+			break;
+		case 's': case 'S':
+			for (auto i: " \t\n\r\f\v") node.set.set(static_cast<uint8_t>(i));
+			node.set.reset(0);
+			break;
+		case 'w': case 'W':
+			for (int i = 0; i < 256; ++i) {
+				if (isalnum(i) || i == '_') node.set.set(i);
+			}
+			break;
+		default:
+			if (c >= '1' && c <= '9' && !in_class) {
+				node.type = Node::BACKREF;
+				node.group = c - '0';
+				return node;
+			}
+			node.type = Node::CHAR;
+			node.c = (c == 'n') ? '\n' : (c == 't') ? '\t' : c;
+			return node;
+	}
+
+	if (isupper(c)) {
+		node.set.flip();
+	}
+	return node;
+}
+
+Node MatcherCompiler::parse_class()
+{
+	Node node(Node::CLASS);
+
+	bool negate = (peek() == '^');
+	if (negate) ++pos;
+
+	while (more() && peek() != ']') {
+		uint8_t lo;
+		if (peek() == '\\') {
+			++pos;
+			auto e = parse_escape(true);
+			if (e.type == Node::CLASS) {
+				node.set |= e.set;
+				continue;
+			}
+			lo = e.c;
+		} else {
+			lo = pattern[pos++];
+		}
+
+		// character range
+		if (peek() == '-' && pos + 1 < pattern.size() && pattern[pos + 1] != ']') {
+			++pos;
+			uint8_t hi = pattern[pos++];
+			if (hi < lo) {
+				error("invalid range");
+			}
+			for (int i = lo; i <= hi; ++i) node.set.set(i);
+		} else {
+			node.set.set(lo);
+		}
+	}
+
+	if (peek() != ']') {
+		error("missing ]");
+	}
+	++pos;
+
+	if (negate) {
+		node.set.flip();
+	}
+	return node;
+}
+
+const Node* MatcherCompiler::find_group(const Node& node, size_t n, bool& repeated, bool in_repeat)
+{
+	if (node.type == Node::GROUP && node.group == n) {
+		repeated = in_repeat;
+		return &node;
+	}
+
+	auto rep = in_repeat || node.type == Node::STAR || node.type == Node::PLUS || node.type == Node::QUEST;
+	for (const auto& kid: node.kids) {
+		auto found = find_group(kid, n, repeated, rep);
+		if (found) return found;
+	}
+	return nullptr;
+}
+
+const Node* MatcherCompiler::find_backref(const Node& node)
+{
+	if (node.type == Node::BACKREF) {
+		return &node;
+	}
+	for (const auto& kid: node.kids) {
+		auto found = find_backref(kid);
+		if (found) return found;
+	}
+	return nullptr;
+}
+
+//
+// the (finite) set of strings that a node matches, in priority order
+//
+bool MatcherCompiler::language(const Node& node, language_t& result)
+{
+	switch (node.type) {
+		case Node::EMPTY:
+			result = { "" };
+			return true;
+		case Node::CHAR:
+			result = { std::string(1, node.c) };
+			return true;
+		case Node::GROUP:
+			return language(node.kids[0], result);
+		case Node::ALT: {
+			result.clear();
+			for (const auto& kid: node.kids) {
+				language_t sub;
+				if (!language(kid, sub)) return false;
+				result.insert(result.end(), sub.begin(), sub.end());
+			}
+			return true;
+		}
+		case Node::CAT: {
+			result = { "" };
+			for (const auto& kid: node.kids) {
+				language_t sub, next;
+				if (!language(kid, sub)) return false;
+				for (const auto& a: result) {
+					for (const auto& b: sub) {
+						next.push_back(a + b);
+					}
+				}
+				result.swap(next);
+			}
+			return true;
+		}
+		default:
+			return false;
+	}
+}
+
+//
+// replace group `n` and back references to it with the literal `s`
+//
+void MatcherCompiler::substitute(Node& node, size_t n, const std::string& s)
+{
+	auto literal = [&]() {
+		Node cat(Node::CAT);
+		for (auto c: s) {
+			Node ch(Node::CHAR);
+			ch.c = c;
+			cat.kids.push_back(ch);
+		}
+		return cat;
+	};
+
+	if (node.type == Node::GROUP && node.group == n) {
+		node.kids[0] = literal();
+		return;
+	}
+
+	if (node.type == Node::BACKREF && node.group == n) {
+		node = literal();
+		return;
+	}
+
+	for (auto& kid: node.kids) {
+		substitute(kid, n, s);
+	}
+}
+
+Node MatcherCompiler::expand(const Node& node)
+{
+	auto backref = find_backref(node);
+	if (!backref) {
+		return node;
+	}
+
+	auto n = backref->group;
+	bool repeated = false;
+	auto group = find_group(node, n, repeated);
+	if (!group) {
+		error("back reference to unknown group");
+	}
+
+	language_t strings;
+	if (repeated || !language(*group, strings)) {
+		error("back reference to a group with unbounded matches");
+	}
+
+	Node alt(Node::ALT);
+	for (const auto& s: strings) {
+		Node copy = node;
+		substitute(copy, n, s);
+		alt.kids.push_back(expand(copy));
+	}
+	return alt;
+}
+
+size_t MatcherCompiler::emit(Matcher::op_t op, uint8_t c, uint16_t x, uint16_t y)
+{
+	m.prog.push_back(Matcher::inst_t { op, c, x, y });
+	return m.prog.size() - 1;
+}
+
+void MatcherCompiler::emit(const Node& node)
+{
+	auto& prog = m.prog;
+
+	switch (node.type) {
+		case Node::EMPTY:
+			break;
+		case Node::CHAR:
+			emit(Matcher::CHAR, node.c);
+			break;
+		case Node::CLASS:
+			m.classes.push_back(node.set);
+			emit(Matcher::CLASS, 0, m.classes.size() - 1);
+			break;
+		case Node::ANY:
+			emit(Matcher::ANY);
+			break;
+		case Node::BOL:
+			emit(Matcher::BOL);
+			break;
+		case Node::EOL:
+			emit(Matcher::EOL);
+			break;
+		case Node::CAT:
+			for (const auto& kid: node.kids) {
+				emit(kid);
+			}
+			break;
+		case Node::ALT: {
+			std::vector<size_t> jumps;
+			for (size_t i = 0; i < node.kids.size(); ++i) {
+				if (i + 1 < node.kids.size()) {
+					auto split = emit(Matcher::SPLIT);
+					prog[split].x = prog.size();
+					emit(node.kids[i]);
+					jumps.push_back(emit(Matcher::JMP));
+					prog[split].y = prog.size();
+				} else {
+					emit(node.kids[i]);
+				}
+			}
+			for (auto j: jumps) {
+				prog[j].x = prog.size();
+			}
+			break;
+		}
+		case Node::STAR: {
+			auto split = emit(Matcher::SPLIT);
+			emit(node.kids[0]);
+			emit(Matcher::JMP, 0, split);
+			auto body = split + 1, out = prog.size();
+			prog[split].x = node.greedy ? body : out;
+			prog[split].y = node.greedy ? out : body;
+			break;
+		}
+		case Node::PLUS: {
+			auto body = prog.size();
+			emit(node.kids[0]);
+			auto split = emit(Matcher::SPLIT);
+			auto out = prog.size();
+			prog[split].x = node.greedy ? body : out;
+			prog[split].y = node.greedy ? out : body;
+			break;
+		}
+		case Node::QUEST: {
+			auto split = emit(Matcher::SPLIT);
+			emit(node.kids[0]);
+			auto body = split + 1, out = prog.size();
+			prog[split].x = node.greedy ? body : out;
+			prog[split].y = node.greedy ? out : body;
+			break;
+		}
+		case Node::GROUP:
+			if (node.group) emit(Matcher::SAVE, 0, node.group * 2);
+			emit(node.kids[0]);
+			if (node.group) emit(Matcher::SAVE, 0, node.group * 2 + 1);
+			break;
+		case Node::BACKREF:
+			error("unexpanded back reference");
+	}
+}
+
+void MatcherCompiler::compile()
+{
+	Node root = parse_alt();
+	if (more()) {
+		error("unbalanced )");
+	}
+
+	m.ngroups = ngroups;
+
+	// whole match is group 0
+	emit(Matcher::SAVE, 0, 0);
+	emit(expand(root));
+	emit(Matcher::SAVE, 0, 1);
+	emit(Matcher::MATCH);
+
+	if (m.prog.size() > UINT16_MAX) {
+		error("pattern too large");
+	}
+}
+
+Matcher::Matcher(const std::string& pattern, bool fold)
+	: fold(fold)
+{
+	MatcherCompiler(pattern, *this).compile();
+}
+
+uint8_t Matcher::in(char c) const
+{
+	auto u = static_cast<uint8_t>(c);
+	return fold ? tolower(u) : u;
+}
+
+//
+// per-thread scratch space for the VM, reused between calls
+//
+namespace {
+
+	typedef const char* slots_t[2 * (Matcher::max_groups + 1)];
+
+	struct thread_t {
+		uint16_t	pc;
+		slots_t		slots;
+	};
+
+	struct list_t {
+		std::vector<thread_t>	threads;
+		size_t			n = 0;
+	};
+
+	struct scratch_t {
+		list_t			lists[2];
+		std::vector<uint32_t>	marks;
+		uint32_t		gen = 0;
+	};
+
+	thread_local scratch_t scratch;
+}
+
+bool Matcher::match(const char* begin, const char* end, captures_t& caps) const
+{
+	auto& s = scratch;
+	auto size = prog.size();
+	if (s.marks.size() < size) {
+		s.marks.assign(size, 0);
+		s.lists[0].threads.resize(size);
+		s.lists[1].threads.resize(size);
+		s.gen = 0;
+	}
+
+	auto nslots = 2 * (ngroups + 1);
+
+	// follow the non-consuming instructions, adding a thread for each
+	// consuming instruction reached that isn't already in the list
+	struct adder_t {
+		const Matcher&	m;
+		scratch_t&	s;
+		const char*	begin;
+		const char*	end;
+		size_t		nslots;
+
+		void add(list_t& list, uint16_t pc, slots_t& slots, const char* p) {
+			if (s.marks[pc] == s.gen) return;
+			s.marks[pc] = s.gen;
+
+			const auto& inst = m.prog[pc];
+			switch (inst.op) {
+				case JMP:
+					add(list, inst.x, slots, p);
+					break;
+				case SPLIT:
+					add(list, inst.x, slots, p);
+					add(list, inst.y, slots, p);
+					break;
+				case SAVE: {
+					auto old = slots[inst.x];
+					slots[inst.x] = p;
+					add(list, pc + 1, slots, p);
+					slots[inst.x] = old;
+					break;
+				}
+				case BOL:
+					if (p == begin) add(list, pc + 1, slots, p);
+					break;
+				case EOL:
+					if (p == end) add(list, pc + 1, slots, p);
+					break;
+				default: {
+					auto& t = list.threads[list.n++];
+					t.pc = pc;
+					std::memcpy(t.slots, slots, nslots * sizeof(slots[0]));
+				}
+			}
+		}
+	} adder { *this, s, begin, end, nslots };
+
+	auto clist = &s.lists[0];
+	auto nlist = &s.lists[1];
+
+	slots_t init = { };
+	clist->n = 0;
+	++s.gen;
+	adder.add(*clist, 0, init, begin);
+
+	for (auto p = begin; clist->n; ++p) {
+
+		// a full match requires a thread at MATCH at the end of input
+		if (p == end) {
+			for (size_t i = 0; i < clist->n; ++i) {
+				const auto& t = clist->threads[i];
+				if (prog[t.pc].op == MATCH) {
+					for (size_t g = 0; g <= ngroups; ++g) {
+						caps[g].first = t.slots[2 * g];
+						caps[g].second = t.slots[2 * g + 1];
+					}
+					for (size_t g = ngroups + 1; g < caps.size(); ++g) {
+						caps[g] = span_t();
+					}
+					return true;
+				}
+			}
+			return false;
+		}
+
+		auto c = in(*p);
+		nlist->n = 0;
+		++s.gen;
+
+		for (size_t i = 0; i < clist->n; ++i) {
+			auto& t = clist->threads[i];
+			const auto& inst = prog[t.pc];
+
+			bool ok = false;
+			switch (inst.op) {
+				case CHAR:	ok = (c == inst.c); break;
+				case CLASS:	ok = classes[inst.x].test(c); break;
+				case ANY:	ok = (c != '\n'); break;
+				default:	break;
+			}
+
+			if (ok) {
+				adder.add(*nlist, t.pc + 1, t.slots, p + 1);
+			}
+		}
+
+		std::swap(clist, nlist);
+	}
+
+	return false;
+}
+
+bool Matcher::match(const std::string& s, captures_t& caps) const
+{
+	return match(s.data(), s.data() + s.size(), caps);
+}
+
+bool Matcher::match(const std::string& s) const
+{
+	captures_t caps;
+	return match(s, caps);
+}
+
+bool Matcher::equal(const span_t& span, const char* s) const
+{
+	auto len = strlen(s);
+	if (!span.matched() || span.length() != len) {
+		return false;
+	}
+
+	for (size_t i = 0; i < len; ++i) {
+		if (in(span.first[i]) != static_cast<uint8_t>(s[i])) {
+			return false;
+		}
+	}
+	return true;
+}
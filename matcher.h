@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//
+// a small precompiled regular expression matcher for the stats
+// name patterns, used in place of std::regex
+//
+// supports the ECMAScript subset used by the drivers: literals,
+// `.`, `^`, `$`, escapes (`\d`, `\s`, `\w` and their negations),
+// bracketed character classes, capturing and `(?:...)` groups,
+// alternation, and the `*`, `+` and `?` quantifiers (greedy or
+// lazy)
+//
+// patterns are compiled to a program for a Pike VM, which runs in
+// time linear in the length of the input and never backtracks - back
+// references (e.g. `(rx|tx)q\d+: \1_bytes`) are only allowed to
+// groups that match a finite set of strings, and are eliminated at
+// compile time by expanding the pattern into one alternative for each
+// of those strings
+//
+// matching is always against the whole input, as per std::regex_match
+//
+class Matcher {
+
+public:
+	static const size_t max_groups = 9;
+
+	struct span_t {
+		const char*	first = nullptr;
+		const char*	second = nullptr;
+
+		bool		matched() const	{ return first != nullptr; };
+		size_t		length() const	{ return second - first; };
+		std::string	str() const	{ return std::string(first, second); };
+	};
+
+	// [0] is the whole match, [n] is capture group `n`
+	typedef std::array<span_t, max_groups + 1> captures_t;
+
+private:
+	enum op_t : uint8_t {
+		CHAR, CLASS, ANY, BOL, EOL, SPLIT, JMP, SAVE, MATCH
+	};
+
+	struct inst_t {
+		op_t		op;
+		uint8_t		c;		// CHAR
+		uint16_t	x;		// CLASS index, SPLIT / JMP target, SAVE slot
+		uint16_t	y;		// SPLIT alternate
+	};
+
+	friend class MatcherCompiler;
+
+	std::vector<inst_t>		prog;
+	std::vector<std::bitset<256>>	classes;
+	size_t				ngroups = 0;
+	bool				fold = false;
+
+	uint8_t				in(char c) const;
+
+public:
+	Matcher() = default;
+
+	// with `fold` set the input is treated as if lower-cased
+	Matcher(const std::string& pattern, bool fold = false);
+
+	size_t				mark_count() const	{ return ngroups; };
+
+	bool				match(const char* begin, const char* end, captures_t& caps) const;
+	bool				match(const std::string& s, captures_t& caps) const;
+	bool				match(const std::string& s) const;
+
+	// compare a captured span with a literal, honouring `fold`
+	bool				equal(const span_t& span, const char* s) const;
+};
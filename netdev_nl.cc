@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <array>
+#include <stdexcept>
+
+#include <net/if.h>
+
+#include "netdev_nl.h"
+#include "ethtool++.h"
+#include "netlink.h"
+#include "util.h"
+
+//
+// from <linux/netdev.h>, which older systems' headers lack
+//
+#define NETDEV_FAMILY_NAME		"netdev"
+#define NETDEV_FAMILY_VERSION		1
+
+enum {
+	NETDEV_CMD_QSTATS_GET = 12,
+};
+
+enum {
+	NETDEV_QSTATS_SCOPE_QUEUE = 1,
+};
+
+enum {
+	NETDEV_QUEUE_TYPE_RX,
+	NETDEV_QUEUE_TYPE_TX,
+};
+
+enum {
+	NETDEV_A_QSTATS_IFINDEX = 1,
+	NETDEV_A_QSTATS_QUEUE_TYPE,
+	NETDEV_A_QSTATS_QUEUE_ID,
+	NETDEV_A_QSTATS_SCOPE,
+	NETDEV_A_QSTATS_RX_PACKETS = 8,
+	NETDEV_A_QSTATS_RX_BYTES,
+	NETDEV_A_QSTATS_TX_PACKETS,
+	NETDEV_A_QSTATS_TX_BYTES,
+	NETDEV_A_QSTATS_RX_ALLOC_FAIL,
+	NETDEV_A_QSTATS_RX_HW_DROPS,
+};
+
+//
+// each queue's packets, bytes and drops (the latter only for receive
+// queues, and only if the driver supplies them) - these are the stats
+// strings' suffixes, in the order in which they appear
+//
+static const char* kinds[] = { "packets", "bytes", "hw_drops" };
+static const size_t nkinds = sizeof(kinds) / sizeof(kinds[0]);
+
+namespace {
+
+typedef std::array<__u64, nkinds> queue_t;
+
+struct entry_t {
+	std::vector<queue_t>	queues[2];	// rx, tx
+	bool			drops = false;
+	bool			seen = false;
+
+	// the shape of the string set, and when it last changed
+	size_t			shape[2] = { };
+	bool			shape_drops = false;
+	unsigned		generation = 0;
+
+	size_t			width(size_t type) const {
+		return (type == NETDEV_QUEUE_TYPE_RX && shape_drops) ? nkinds : nkinds - 1;
+	}
+};
+
+}
+
+class NetdevNetlink::Batch : public NetlinkDump<entry_t> {
+
+private:
+	uint16_t		family;
+
+	NetlinkMessage		request();
+	void			parse(const nlmsghdr* nlh);
+	void			dump();
+
+public:
+	Batch();
+};
+
+NetdevNetlink::Batch::Batch()
+	: NetlinkDump(NETLINK_GENERIC)
+{
+	family = nl.family(NETDEV_FAMILY_NAME);
+}
+
+// one message per queue
+void NetdevNetlink::Batch::parse(const nlmsghdr* nlh)
+{
+	int ifindex = -1;
+	int type = -1;
+	long id = -1;
+	queue_t values = { };
+	bool drops = false;
+	bool seen = false;
+
+	Netlink::genl_attrs(nlh).each([&](uint16_t attr, const nlattr* a) {
+		switch (attr) {
+			case NETDEV_A_QSTATS_IFINDEX:
+				ifindex = NetlinkAttrs::u32(a);
+				break;
+			case NETDEV_A_QSTATS_QUEUE_TYPE:
+				type = NetlinkAttrs::u32(a);
+				break;
+			case NETDEV_A_QSTATS_QUEUE_ID:
+				id = NetlinkAttrs::u32(a);
+				break;
+			case NETDEV_A_QSTATS_RX_PACKETS:
+			case NETDEV_A_QSTATS_TX_PACKETS:
+				values[0] = NetlinkAttrs::u64(a);
+				seen = true;
+				break;
+			case NETDEV_A_QSTATS_RX_BYTES:
+			case NETDEV_A_QSTATS_TX_BYTES:
+				values[1] = NetlinkAttrs::u64(a);
+				seen = true;
+				break;
+			case NETDEV_A_QSTATS_RX_HW_DROPS:
+				values[2] = NetlinkAttrs::u64(a);
+				drops = true;
+				break;
+		}
+	});
+
+	if ((type != NETDEV_QUEUE_TYPE_RX && type != NETDEV_QUEUE_TYPE_TX) || id < 0) {
+		return;
+	}
+
+	// skip interfaces we're not monitoring
+	auto entry = slot(ifindex);
+	if (!entry) {
+		return;
+	}
+
+	auto& queues = entry->queues[type];
+	if (static_cast<size_t>(id) >= queues.size()) {
+		queues.resize(id + 1, queue_t());
+	}
+
+	queues[id] = values;
+	entry->drops |= (drops && type == NETDEV_QUEUE_TYPE_RX);
+	entry->seen |= seen;
+}
+
+NetlinkMessage NetdevNetlink::Batch::request()
+{
+	NetlinkMessage msg(family, NLM_F_DUMP);
+
+	genlmsghdr genl = { };
+	genl.cmd = NETDEV_CMD_QSTATS_GET;
+	genl.version = NETDEV_FAMILY_VERSION;
+	msg.put(&genl, sizeof genl);
+	msg.put_u32(NETDEV_A_QSTATS_SCOPE, NETDEV_QSTATS_SCOPE_QUEUE);
+
+	return msg;
+}
+
+void NetdevNetlink::Batch::dump()
+{
+	// the vectors keep their capacity, so this doesn't reallocate
+	for (auto& entry: entries) {
+		for (auto& queues: entry.second.queues) {
+			queues.clear();
+		}
+		entry.second.drops = false;
+	}
+
+	NetlinkDump::dump();
+
+	// a change in the set of queues is a new string set
+	for (auto& iter: entries) {
+		auto& entry = iter.second;
+		if (entry.queues[0].size() != entry.shape[0] || entry.queues[1].size() != entry.shape[1] ||
+		    entry.drops != entry.shape_drops)
+		{
+			entry.shape[0] = entry.queues[0].size();
+			entry.shape[1] = entry.queues[1].size();
+			entry.shape_drops = entry.drops;
+			++entry.generation;
+		}
+	}
+}
+
+NetdevNetlink::NetdevNetlink(const std::string& ifname)
+	: _name(ifname)
+{
+	ifindex = if_nametoindex(ifname.c_str());
+	if (!ifindex) {
+		throw_errno("if_nametoindex(" + ifname + ")");
+	}
+
+	// the driver details still come from a one-off ioctl
+	{
+		Ethtool ethtool(ifname);
+		_driver = ethtool.driver();
+		_version = ethtool.version();
+	}
+
+	batch = shared_dump<Batch>();
+	batch->add(ifindex);
+	if (!batch->supported(ifindex)) {
+		batch->remove(ifindex);
+		throw std::runtime_error("no netdev netlink queue stats for " + _driver + ":" + ifname);
+	}
+}
+
+NetdevNetlink::~NetdevNetlink()
+{
+	batch->remove(ifindex);
+}
+
+NetdevNetlink::stringset_t NetdevNetlink::stringset(ethtool_stringset ss)
+{
+	static const char* prefixes[] = { "rx", "tx" };
+
+	stringset_t result;
+	if (ss != ETH_SS_STATS) {
+		return result;
+	}
+
+	batch->with(ifindex, [&](entry_t& entry) {
+		for (size_t type = 0; type < 2; ++type) {
+			for (size_t q = 0; q < entry.shape[type]; ++q) {
+				auto prefix = std::string(prefixes[type]) + "_queue_" + std::to_string(q) + "_";
+				for (size_t k = 0; k < entry.width(type); ++k) {
+					result.push_back(prefix + kinds[k]);
+				}
+			}
+		}
+	});
+	return result;
+}
+
+void NetdevNetlink::stats(snapshot_t& snap)
+{
+	_stamp = batch->get(ifindex, [&](entry_t& entry) {
+		snap.resize(entry.shape[0] * entry.width(0) + entry.shape[1] * entry.width(1));
+		auto p = snap.data();
+		for (size_t type = 0; type < 2; ++type) {
+			for (const auto& queue: entry.queues[type]) {
+				for (size_t k = 0; k < entry.width(type); ++k) {
+					*p++ = queue[k];
+				}
+			}
+		}
+		_generation = entry.generation;
+	});
+}
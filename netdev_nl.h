@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "source.h"
+
+//
+// reads the driver-independent per-queue counters of the netdev
+// generic netlink family (`qstats-get`, Linux 6.10 and later) instead
+// of the driver's private ethtool stats, for the drivers that support
+// it - which gives per-queue stats on drivers that have no parser, and
+// fetches just those counters instead of the driver's whole table
+//
+// as with EthtoolNetlink, all instances share a single netlink socket,
+// and one dump per tick retrieves the counters of every queue of every
+// interface - the first interface to ask for its stats in a tick
+// triggers the dump, and the others consume the values it fetched,
+// along with the timestamp of that dump
+//
+// the stats strings are synthesized from the queues that the dump
+// returns (e.g. "rx_queue_3_bytes"), and the generation changes if the
+// set of queues does, e.g. after `ethtool -L`
+//
+class NetdevNetlink : public StatsSource {
+
+public:
+	class Batch;
+
+private:
+	Batch*			batch;
+
+	std::string		_name;
+	int			ifindex;
+	std::string		_driver;
+	std::string		_version;
+	unsigned		_generation = 0;
+	uint64_t		_stamp = 0;
+
+public:
+				NetdevNetlink(const std::string& ifname);
+				~NetdevNetlink();
+
+public:
+	stringset_t		stringset(ethtool_stringset);
+	void			stats(snapshot_t& snap);
+	unsigned		generation()	{ return _generation; };
+	uint64_t		stamp()		{ return _stamp; };
+
+	std::string		driver()	{ return _driver; };
+	std::string		version()	{ return _version; };
+	std::string		parser()	{ return "netdev"; };
+};
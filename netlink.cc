@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "netlink.h"
+#include "util.h"
+
+NetlinkMessage::NetlinkMessage(uint16_t type, uint16_t flags)
+{
+	buf.reserve(256);
+	auto nlh = reinterpret_cast<nlmsghdr*>(reserve(NLMSG_HDRLEN));
+	nlh->nlmsg_type = type;
+	nlh->nlmsg_flags = flags;
+}
+
+void* NetlinkMessage::reserve(size_t len)
+{
+	auto offset = buf.size();
+	buf.resize(offset + NLMSG_ALIGN(len), 0);
+	header()->nlmsg_len = buf.size();
+	return buf.data() + offset;
+}
+
+nlmsghdr* NetlinkMessage::header()
+{
+	return reinterpret_cast<nlmsghdr*>(buf.data());
+}
+
+size_t NetlinkMessage::size() const
+{
+	return buf.size();
+}
+
+void NetlinkMessage::put(const void* data, size_t len)
+{
+	auto p = reserve(len);
+	std::memcpy(p, data, len);
+}
+
+void NetlinkMessage::put_attr(uint16_t type, const void* data, size_t len)
+{
+	auto p = reinterpret_cast<char*>(reserve(NLA_HDRLEN + len));
+	auto& nla = *reinterpret_cast<nlattr*>(p);
+	nla.nla_type = type;
+	nla.nla_len = NLA_HDRLEN + len;
+	if (len) {
+		std::memcpy(p + NLA_HDRLEN, data, len);
+	}
+}
+
+void NetlinkMessage::put_u32(uint16_t type, uint32_t value)
+{
+	put_attr(type, &value, sizeof value);
+}
+
+void NetlinkMessage::put_string(uint16_t type, const std::string& value)
+{
+	put_attr(type, value.c_str(), value.size() + 1);
+}
+
+void NetlinkMessage::put_flag(uint16_t type)
+{
+	put_attr(type, nullptr, 0);
+}
+
+void NetlinkMessage::nest_begin(uint16_t type)
+{
+	nests.push_back(buf.size());
+	put_attr(type | NLA_F_NESTED, nullptr, 0);
+}
+
+void NetlinkMessage::nest_end()
+{
+	auto offset = nests.back();
+	nests.pop_back();
+
+	auto& nla = *reinterpret_cast<nlattr*>(buf.data() + offset);
+	nla.nla_len = buf.size() - offset;
+}
+
+NetlinkAttrs::NetlinkAttrs(const void* data, size_t len)
+	: attr(reinterpret_cast<const nlattr*>(data)), len(len)
+{
+}
+
+void NetlinkAttrs::each(const std::function<void(uint16_t, const nlattr*)>& fn) const
+{
+	auto p = reinterpret_cast<const char*>(attr);
+	auto remain = len;
+
+	while (remain >= NLA_HDRLEN) {
+		auto a = reinterpret_cast<const nlattr*>(p);
+		if (a->nla_len < NLA_HDRLEN || a->nla_len > remain) {
+			break;
+		}
+
+		fn(a->nla_type & NLA_TYPE_MASK, a);
+
+		size_t step = NLA_ALIGN(a->nla_len);
+		if (step >= remain) break;
+		p += step;
+		remain -= step;
+	}
+}
+
+const void* NetlinkAttrs::data(const nlattr* a)
+{
+	return reinterpret_cast<const char*>(a) + NLA_HDRLEN;
+}
+
+size_t NetlinkAttrs::size(const nlattr* a)
+{
+	return a->nla_len - NLA_HDRLEN;
+}
+
+uint32_t NetlinkAttrs::u32(const nlattr* a)
+{
+	uint32_t value = 0;
+	std::memcpy(&value, data(a), std::min(size(a), sizeof value));
+	return value;
+}
+
+uint64_t NetlinkAttrs::u64(const nlattr* a)
+{
+	uint64_t value = 0;
+	std::memcpy(&value, data(a), std::min(size(a), sizeof value));
+	return value;
+}
+
+std::string NetlinkAttrs::string(const nlattr* a)
+{
+	auto p = reinterpret_cast<const char*>(data(a));
+	return std::string(p, strnlen(p, size(a)));
+}
+
+NetlinkAttrs NetlinkAttrs::nested(const nlattr* a)
+{
+	return NetlinkAttrs(data(a), size(a));
+}
+
+Netlink::Netlink(int protocol)
+	: rxbuf(65536)
+{
+	fd = ::socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, protocol);
+	if (fd < 0) {
+		throw_errno("socket(AF_NETLINK)");
+	}
+
+	// large dumps for many interfaces arrive in quick succession
+	int rcvbuf = 1 << 20;
+	::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+
+	int one = 1;
+	::setsockopt(fd, SOL_NETLINK, NETLINK_EXT_ACK, &one, sizeof one);
+	::setsockopt(fd, SOL_NETLINK, NETLINK_CAP_ACK, &one, sizeof one);
+}
+
+Netlink::~Netlink()
+{
+	::close(fd);
+}
+
+void Netlink::request(NetlinkMessage& msg, const callback_t& cb)
+{
+	auto nlh = msg.header();
+	auto dump = (nlh->nlmsg_flags & NLM_F_DUMP) == NLM_F_DUMP;
+
+	nlh->nlmsg_flags |= NLM_F_REQUEST | NLM_F_ACK;
+	nlh->nlmsg_seq = ++seq;
+
+	sockaddr_nl sa = { };
+	sa.nl_family = AF_NETLINK;
+
+	if (::sendto(fd, nlh, msg.size(), 0, reinterpret_cast<sockaddr*>(&sa), sizeof sa) < 0) {
+		throw_errno("sendto(AF_NETLINK)");
+	}
+
+	while (true) {
+		auto n = ::recv(fd, rxbuf.data(), rxbuf.size(), 0);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			throw_errno("recv(AF_NETLINK)");
+		}
+
+		auto len = static_cast<size_t>(n);
+		for (auto h = reinterpret_cast<const nlmsghdr*>(rxbuf.data());
+		     NLMSG_OK(h, len); h = NLMSG_NEXT(h, len))
+		{
+			if (h->nlmsg_seq != seq) {
+				continue;
+			}
+
+			if (h->nlmsg_type == NLMSG_ERROR || h->nlmsg_type == NLMSG_DONE) {
+				int error = 0;
+				if (h->nlmsg_len >= NLMSG_LENGTH(sizeof error)) {
+					std::memcpy(&error, NLMSG_DATA(h), sizeof error);
+				}
+				if (error < 0) {
+					errno = -error;
+					throw_errno("netlink request");
+				}
+
+				// a dump ends with NLMSG_DONE, anything else with an ACK
+				if (h->nlmsg_type == NLMSG_DONE || !dump) {
+					return;
+				}
+				continue;
+			}
+
+			cb(h);
+		}
+	}
+}
+
+uint16_t Netlink::family(const std::string& name)
+{
+	NetlinkMessage msg(GENL_ID_CTRL, 0);
+
+	genlmsghdr genl = { };
+	genl.cmd = CTRL_CMD_GETFAMILY;
+	genl.version = 1;
+	msg.put(&genl, sizeof genl);
+	msg.put_string(CTRL_ATTR_FAMILY_NAME, name);
+
+	uint16_t id = 0;
+	request(msg, [&](const nlmsghdr* nlh) {
+		genl_attrs(nlh).each([&](uint16_t type, const nlattr* a) {
+			if (type == CTRL_ATTR_FAMILY_ID) {
+				id = *reinterpret_cast<const uint16_t*>(NetlinkAttrs::data(a));
+			}
+		});
+	});
+
+	if (!id) {
+		throw std::runtime_error("netlink family " + name + " not found");
+	}
+
+	return id;
+}
+
+NetlinkAttrs Netlink::genl_attrs(const nlmsghdr* nlh)
+{
+	auto offset = NLMSG_HDRLEN + GENL_HDRLEN;
+	auto p = reinterpret_cast<const char*>(nlh) + offset;
+	auto len = nlh->nlmsg_len > offset ? nlh->nlmsg_len - offset : 0;
+	return NetlinkAttrs(p, len);
+}
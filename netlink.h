@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <functional>
+#include <map>
+#include <iterator>
+#include <mutex>
+#include <utility>
+
+#include <linux/netlink.h>
+#include <linux/genetlink.h>
+
+#include "util.h"
+
+//
+// a netlink request under construction - the message header
+// is followed by an optional fixed header (e.g. genlmsghdr)
+// and then by a list of (possibly nested) attributes
+//
+class NetlinkMessage {
+
+private:
+	std::vector<char>	buf;
+	std::vector<size_t>	nests;
+
+	void*			reserve(size_t len);
+
+public:
+	NetlinkMessage(uint16_t type, uint16_t flags);
+
+	nlmsghdr*		header();
+	size_t			size() const;
+
+	void			put(const void* data, size_t len);
+	void			put_attr(uint16_t type, const void* data, size_t len);
+	void			put_u32(uint16_t type, uint32_t value);
+	void			put_string(uint16_t type, const std::string& value);
+	void			put_flag(uint16_t type);
+
+	void			nest_begin(uint16_t type);
+	void			nest_end();
+};
+
+//
+// read-only view over a run of attributes, e.g. the payload of
+// a message or of a nested attribute
+//
+class NetlinkAttrs {
+
+private:
+	const nlattr*		attr;
+	size_t			len;
+
+public:
+	NetlinkAttrs(const void* data, size_t len);
+
+	// iterate calling `fn(type, attr)` for every attribute
+	void			each(const std::function<void(uint16_t, const nlattr*)>& fn) const;
+
+	static const void*	data(const nlattr* a);
+	static size_t		size(const nlattr* a);
+	static uint32_t		u32(const nlattr* a);
+	static uint64_t		u64(const nlattr* a);
+	static std::string	string(const nlattr* a);
+	static NetlinkAttrs	nested(const nlattr* a);
+};
+
+//
+// a single netlink socket - requests are sent synchronously and the
+// replies (including all parts of a dump) are passed to a callback
+//
+class Netlink {
+
+public:
+	typedef std::function<void(const nlmsghdr*)> callback_t;
+
+private:
+	int			fd;
+	uint32_t		seq = 0;
+	std::vector<char>	rxbuf;
+
+public:
+				Netlink(int protocol);
+				~Netlink();
+
+	int			get_fd() const { return fd; }
+
+	void			request(NetlinkMessage& msg, const callback_t& cb);
+
+	// resolve a generic netlink family name into its numeric ID
+	uint16_t		family(const std::string& name);
+
+	// payload of a generic netlink message, after the genlmsghdr
+	static NetlinkAttrs	genl_attrs(const nlmsghdr* nlh);
+};
+
+//
+// the state shared by all of the interfaces whose stats come from one
+// dump of every interface's counters, so that a single dump per tick
+// serves them all - the first interface to ask for its stats in a tick
+// triggers the dump, and the others consume the values it fetched
+//
+// an `Entry` holds one interface's values, and its `seen` flag is set by
+// the dump if the interface has any - the subclass supplies the dump,
+// and finds each interface's entry with slot()
+//
+// checking whether a new interface is supported takes a census: a dump
+// that keeps every interface's values, not just those of the interfaces
+// in use, so that setting up many interfaces takes one dump rather than
+// one each - what's left unused is dropped by the next dump
+//
+// NB: interfaces may be set up and sampled from multiple threads, so
+// everything is done under a single lock
+//
+template<typename Key, typename Entry>
+class SharedDump {
+
+protected:
+	struct slot_t : Entry {
+		bool			fresh = false;
+		bool			dumped = false;
+		unsigned		users = 0;
+	};
+
+	std::map<Key, slot_t>		entries;
+	bool				census = false;
+
+	// update the entries, with the lock held
+	virtual void			dump() = 0;
+
+	// the entry for an interface in the dump, if it's wanted
+	Entry* slot(const Key& key) {
+		if (census) {
+			return &entries[key];
+		}
+		auto iter = entries.find(key);
+		return (iter == entries.end()) ? nullptr : &iter->second;
+	}
+
+private:
+	std::mutex			mutex;
+	uint64_t			taken = 0;	// midpoint of the latest dump
+
+	void refresh() {
+		if (!census) {
+			for (auto iter = entries.begin(); iter != entries.end(); ) {
+				iter = iter->second.users ? std::next(iter) : entries.erase(iter);
+			}
+		}
+
+		auto before = clock_ns();
+		dump();
+		auto after = clock_ns();
+
+		taken = before + (after - before) / 2;
+		for (auto& entry: entries) {
+			entry.second.fresh = true;
+			entry.second.dumped = true;
+		}
+	}
+
+public:
+	virtual ~SharedDump() = default;
+
+	void add(const Key& key) {
+		std::lock_guard<std::mutex> lock(mutex);
+		++entries[key].users;
+	}
+
+	void remove(const Key& key) {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto iter = entries.find(key);
+		if (iter != entries.end() && --iter->second.users == 0) {
+			entries.erase(iter);
+		}
+	}
+
+	// whether the latest census found values for an interface, taking
+	// a new one if it's not been dumped since it was added
+	bool supported(const Key& key) {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto& entry = entries[key];
+		if (!entry.dumped) {
+			census = true;
+			try {
+				refresh();
+			} catch (...) {
+				census = false;
+				throw;
+			}
+			census = false;
+		}
+		return entry.seen;
+	}
+
+	// call `fn(entry)` with the latest values - a second read by the same
+	// interface means a new tick - and return when the dump was taken
+	template<typename Fn>
+	uint64_t get(const Key& key, Fn fn) {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto& entry = entries[key];
+		if (!entry.fresh) {
+			refresh();
+		}
+		fn(static_cast<Entry&>(entry));
+		entry.fresh = false;
+		return taken;
+	}
+
+	// call `fn(entry)` without a dump, e.g. to build the stats strings
+	template<typename Fn>
+	void with(const Key& key, Fn fn) {
+		std::lock_guard<std::mutex> lock(mutex);
+		fn(static_cast<Entry&>(entries[key]));
+	}
+};
+
+//
+// a SharedDump of a netlink family, keyed by ifindex - the subclass
+// supplies the dump request and the parser for each of its replies
+//
+template<typename Entry>
+class NetlinkDump : public SharedDump<int, Entry> {
+
+protected:
+	Netlink				nl;
+
+	virtual NetlinkMessage		request() = 0;
+	virtual void			parse(const nlmsghdr* nlh) = 0;
+
+	void dump() {
+		auto msg = request();
+		nl.request(msg, [&](const nlmsghdr* nlh) {
+			parse(nlh);
+		});
+	}
+
+public:
+	NetlinkDump(int protocol) : nl(protocol) { }
+};
+
+//
+// the single instance of a SharedDump subclass, created on first use -
+// interfaces may be set up concurrently
+//
+template<typename T, typename... Args>
+T* shared_dump(Args&&... args)
+{
+	static std::once_flag once;
+	static T* instance = nullptr;
+	std::call_once(once, [&] {
+		instance = new T(std::forward<Args>(args)...);
+	});
+	return instance;
+}
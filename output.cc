@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <unistd.h>
+
+#include "output.h"
+#include "format.h"
+#include "util.h"
+
+static const char* fields[] = {
+	"time_ns", "nic", "queue", "interval_ns",
+	"tx_packets", "rx_packets", "tx_bytes", "rx_bytes", "tx_drops", "rx_drops",
+	"tx_pps", "rx_pps", "tx_bps", "rx_bps", "tx_drop_pps", "rx_drop_pps",
+	"tx_max_mean", "rx_max_mean", "tx_cv", "rx_cv",
+	"tx_hottest", "rx_hottest", "tx_idle", "rx_idle"
+};
+
+static const size_t nfields = sizeof fields / sizeof fields[0];
+
+StreamOutput::format_t StreamOutput::parse(const std::string& name)
+{
+	if (name == "csv") {
+		return CSV;
+	} else if (name == "jsonl") {
+		return JSONL;
+	} else {
+		throw std::runtime_error("unknown output format: " + name);
+	}
+}
+
+StreamOutput::StreamOutput(format_t format, int fd)
+	: format(format), fd(fd), buf(64 * 1024)
+{
+	epoch = clock_ns(CLOCK_REALTIME) - clock_ns(CLOCK_MONOTONIC);
+
+	if (format == CSV) {
+		for (size_t f = 0; f < nfields; ++f) {
+			auto n = strlen(fields[f]);
+			auto p = reserve(n + 1);
+			memcpy(p, fields[f], n);
+			p[n] = (f + 1 < nfields) ? ',' : '\n';
+			len += n + 1;
+		}
+		flush();
+	}
+}
+
+char* StreamOutput::reserve(size_t n)
+{
+	if (len + n > buf.size()) {
+		buf.resize(std::max(buf.size() * 2, len + n));
+	}
+	return &buf[len];
+}
+
+void StreamOutput::record(const std::string& name, long queue, uint64_t stamp,
+			  uint64_t elapsed, const Interface::ifstats_t& stats,
+			  const Interface::balance_t* balance)
+{
+	auto json = (format == JSONL);
+
+	// room for the fixed fields and every char of the name escaped
+	auto p = reserve(1024 + 2 * name.size());
+	auto start = p;
+	size_t f = 0;
+
+	auto key = [&]() {
+		if (f) *p++ = ',';
+		if (json) {
+			*p++ = '"';
+			auto n = strlen(fields[f]);
+			memcpy(p, fields[f], n);
+			p += n;
+			*p++ = '"';
+			*p++ = ':';
+		}
+		++f;
+	};
+
+	auto null = [&]() {
+		if (json) {
+			memcpy(p, "null", 4);
+			p += 4;
+		}
+	};
+
+	if (json) *p++ = '{';
+
+	key();
+	p = fmt_u64(p, stamp + epoch);
+
+	//
+	// the name is always quoted in JSON, and in CSV only if it needs
+	// to be - Linux allows both ',' and '"' in interface names
+	//
+	key();
+	auto quote = json || name.find_first_of(",\"") != std::string::npos;
+	if (quote) *p++ = '"';
+	for (auto c: name) {
+		if (json && (c == '"' || c == '\\')) *p++ = '\\';
+		if (!json && c == '"') *p++ = '"';
+		*p++ = c;
+	}
+	if (quote) *p++ = '"';
+
+	key();
+	if (queue >= 0) {
+		p = fmt_u64(p, queue);
+	} else {
+		null();
+	}
+
+	key();
+	p = fmt_u64(p, elapsed);
+
+	// the raw deltas
+	for (size_t n = 0; n < 6; ++n) {
+		key();
+		if (stats.has(n)) {
+			p = fmt_u64(p, stats.counts[n]);
+		} else {
+			null();
+		}
+	}
+
+	// and as rates, in packets and bits per second
+	for (size_t n = 0; n < 6; ++n) {
+		key();
+		if (stats.has(n)) {
+			auto rate = stats.counts[n] * 1e9 / elapsed;
+			p = fmt_fixed(p, (n == 2 || n == 3) ? rate * 8 : rate, 3);
+		} else {
+			null();
+		}
+	}
+
+	// and the queue balance, for the NIC totals
+	for (size_t n = 0; n < 8; ++n) {
+		key();
+		if (!balance || !balance[n & 1].valid) {
+			null();
+			continue;
+		}
+
+		auto& b = balance[n & 1];
+		if (n < 4) {
+			p = fmt_fixed(p, n < 2 ? b.ratio : b.cv, 3);
+		} else {
+			p = fmt_u64(p, n < 6 ? b.hottest : b.idle);
+		}
+	}
+
+	if (json) *p++ = '}';
+	*p++ = '\n';
+
+	len += p - start;
+}
+
+void StreamOutput::flush()
+{
+	size_t done = 0;
+	while (done < len) {
+		auto res = ::write(fd, &buf[done], len - done);
+		if (res < 0) {
+			if (errno == EINTR) continue;
+			throw_errno("write");
+		}
+		done += res;
+	}
+	len = 0;
+}
+
+void StreamOutput::write(const ifaces_t& ifaces)
+{
+	stamps.resize(ifaces.size());
+
+	for (size_t i = 0; i < ifaces.size(); ++i) {
+		auto& iface = ifaces[i];
+		auto stamp = iface->timestamp();
+		auto elapsed = iface->interval_ns();
+
+		// only new samples, and not the initial one
+		if (stamp == stamps[i] || elapsed == 0) {
+			continue;
+		}
+		stamps[i] = stamp;
+
+		auto& name = iface->name();
+		const Interface::balance_t balance[2] = { iface->balance(false), iface->balance(true) };
+		record(name, -1, stamp, elapsed, iface->total_stats(), balance);
+		for (size_t q = 0, n = iface->queue_count(); q < n; ++q) {
+			record(name, q, stamp, elapsed, iface->queue_stats(q), nullptr);
+		}
+	}
+
+	flush();
+}
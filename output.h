@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "render.h"
+
+//
+// machine-readable output, with one record per NIC total and per
+// queue for each new sample
+//
+// each record carries the wall-clock time of the sample (ns since
+// the epoch), the time since the previous sample (ns), the raw deltas
+// of the packet, byte and drop counters and the corresponding rates in
+// packets/s and bits/s - counters that the NIC doesn't supply are left empty (CSV)
+// or null (JSON), as is the queue number of the totals
+//
+// the NIC totals also carry the measures of how evenly the packets
+// were spread over the queues, which are empty or null for the queues
+// themselves and for NICs with fewer than two queues
+//
+// a NIC whose sample wasn't ready in time for a tick is left out of
+// that tick's output, rather than repeating its previous deltas
+//
+// the records for each tick are assembled in a single buffer and
+// written with one system call
+//
+class StreamOutput {
+
+public:
+	enum format_t { CSV, JSONL };
+
+	// parses "csv" or "jsonl"
+	static format_t			parse(const std::string& name);
+
+private:
+	format_t			format;
+	int				fd;
+	int64_t				epoch;		// CLOCK_REALTIME - CLOCK_MONOTONIC, ns
+	std::vector<char>		buf;
+	size_t				len = 0;
+	std::vector<uint64_t>		stamps;
+
+	char*				reserve(size_t n);
+	void				record(const std::string& name, long queue, uint64_t stamp,
+					       uint64_t elapsed, const Interface::ifstats_t& stats,
+					       const Interface::balance_t* balance);
+	void				flush();
+
+public:
+	StreamOutput(format_t format, int fd = 1);
+
+	void				write(const ifaces_t& ifaces);
+};
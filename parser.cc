@@ -9,7 +9,8 @@
  * information regarding copyright ownership.
  */
 
-#include <regex>
+#include <string>
+
 #include "parser.h"
 
 StringsetParser::parsermap_t *StringsetParser::parsers = nullptr;
@@ -55,39 +56,71 @@ RegexParser::queue_str_t RegexParser::queue_nomatch() {
 	return queue_str_t { "", { 0, 0, 0 } };
 }
 
+// the netdev-level drop counters that go with total_generic()
+RegexParser::drop_total_str_t RegexParser::drop_total_generic() {
+	return drop_total_str_t { "^(rx|tx)_dropped$", 1 };
+}
+
+RegexParser::drop_total_str_t RegexParser::drop_total_nomatch() {
+	return drop_total_str_t { "", 0 };
+}
+RegexParser::drop_queue_str_t RegexParser::drop_queue_nomatch() {
+	return drop_queue_str_t { "", { 0, 0 } };
+}
+
 RegexParser::RegexParser(
 	const driverlist_t& drivers,
 	const total_str_t& total,
-	const queue_str_t& queue
+	const queue_str_t& queue,
+	const drop_total_str_t& drop_total,
+	const drop_queue_str_t& drop_queue
 ) : StringsetParser(drivers),
-    total(std::regex(total.first), total.second),
-    queue(std::regex(queue.first), queue.second)
+    total(Matcher(total.first, true), total.second),
+    queue(Matcher(queue.first, true), queue.second),
+    drop_total(Matcher(drop_total.first, true), drop_total.second),
+    drop_queue(Matcher(drop_queue.first, true), drop_queue.second)
 {
+	// the patterns and the order of their groups, one per line
+	auto add = [&](const std::string& re, const int* order, size_t n) {
+		_fingerprint += re;
+		for (size_t i = 0; i < n; ++i) {
+			_fingerprint += " " + std::to_string(order[i]);
+		}
+		_fingerprint += "\n";
+	};
+
+	add(total.first, total.second.data(), total.second.size());
+	add(queue.first, queue.second.data(), queue.second.size());
+	add(drop_total.first, &drop_total.second, 1);
+	add(drop_queue.first, drop_queue.second.data(), drop_queue.second.size());
 }
 
-std::string RegexParser::ms(size_t n) {
-	return std::ssub_match(ma[n]).str();
+std::string RegexParser::fingerprint() const
+{
+	return _fingerprint;
 }
 
+//
+// NB: the matchers fold the key to lower case, as do their
+// comparisons with the captured values
+//
 bool RegexParser::match_total(const std::string& key, size_t value, bool& rx, bool& bytes)
 {
 	// ignore blank REs
-	if (total.first.mark_count() == 0) return false;
+	auto& re = total.first;
+	if (re.mark_count() == 0) return false;
 
-	// transform key to lower case
-	std::string lower(key);
-	std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
-
-	auto found = std::regex_match(lower, ma, total.first);
+	Matcher::captures_t ma;
+	auto found = re.match(key, ma);
 	if (found) {
 		auto& order = total.second;
 
 		// extract direction and type
-		auto direction = ms(order[0]);
-		auto type = ms(order[1]);
+		const auto& direction = ma[order[0]];
+		const auto& type = ma[order[1]];
 
-		rx = (direction == "rx");
-		bytes = (type == "bytes") || (type == "octets");
+		rx = re.equal(direction, "rx");
+		bytes = re.equal(type, "bytes") || re.equal(type, "octets");
 	}
 	return found;
 }
@@ -95,24 +128,52 @@ bool RegexParser::match_total(const std::string& key, size_t value, bool& rx, bo
 bool RegexParser::match_queue(const std::string& key, size_t value, bool& rx, bool& bytes, size_t& qnum)
 {
 	// ignore blank REs
-	if (queue.first.mark_count() == 0) return false;
-
-	// transform key to lower case
-	std::string lower(key);
-	std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+	auto& re = queue.first;
+	if (re.mark_count() == 0) return false;
 
-	auto found = std::regex_match(lower, ma, queue.first);
+	Matcher::captures_t ma;
+	auto found = re.match(key, ma);
 	if (found) {
 		auto& order = queue.second;
 
 		// extract direction and type
-		auto direction = ms(order[0]);
-		auto type = ms(order[1]);
-		auto qstr = ms(order[2]);
+		const auto& direction = ma[order[0]];
+		const auto& type = ma[order[1]];
+		const auto& qstr = ma[order[2]];
+
+		rx = re.equal(direction, "rx");
+		bytes = re.equal(type, "bytes") || re.equal(type, "octets");
+		qnum = std::stoi(qstr.str());
+	}
+	return found;
+}
 
-		rx = (direction == "rx");
-		bytes = (type == "bytes") || (type == "octets");
-		qnum = std::stoi(qstr);
+bool RegexParser::match_drop_total(const std::string& key, size_t value, bool& rx)
+{
+	// ignore blank REs
+	auto& re = drop_total.first;
+	if (re.mark_count() == 0) return false;
+
+	Matcher::captures_t ma;
+	auto found = re.match(key, ma);
+	if (found) {
+		rx = re.equal(ma[drop_total.second], "rx");
+	}
+	return found;
+}
+
+bool RegexParser::match_drop_queue(const std::string& key, size_t value, bool& rx, size_t& qnum)
+{
+	// ignore blank REs
+	auto& re = drop_queue.first;
+	if (re.mark_count() == 0) return false;
+
+	Matcher::captures_t ma;
+	auto found = re.match(key, ma);
+	if (found) {
+		auto& order = drop_queue.second;
+		rx = re.equal(ma[order[0]], "rx");
+		qnum = std::stoi(ma[order[1]].str());
 	}
 	return found;
 }
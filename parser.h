@@ -16,7 +16,8 @@
 #include <vector>
 #include <array>
 #include <map>
-#include <regex>
+
+#include "matcher.h"
 
 //
 // abstract base class for stats string parsers, includes a static
@@ -49,6 +50,36 @@ public:
 		return false;
 	}
 
+	//
+	// drop and error counters - packets that were lost (e.g. for
+	// want of a receive buffer) or discarded as bad - where a driver
+	// has several that count the same packets only one should match
+	//
+	virtual bool match_drop_total(const std::string& key, size_t value, bool& rx) {
+		return false;
+	}
+
+	virtual bool match_drop_queue(const std::string& key, size_t value, bool& rx, size_t& queue) {
+		return false;
+	}
+
+	//
+	// true if the parser's results depend on the values passed
+	// as well as on the keys, in which case the results can't be
+	// shared between NICs with identical string sets
+	//
+	virtual bool value_dependent() const {
+		return false;
+	}
+
+	//
+	// describes how the parser classifies the stats (e.g. its regexes),
+	// so that a cached map is rebuilt if the parser is changed
+	//
+	virtual std::string fingerprint() const {
+		return std::string();
+	}
+
 public:
 	static ptr_t find(const std::string& driver);
 };
@@ -66,36 +97,60 @@ public:
 //     match on "type" requires an exact match for "bytes"
 //     or "octets"
 //
+// the optional drop counter regexes have no type field, so their
+// tables just give the groups for the direction and (per queue) the
+// queue number
+//
 class RegexParser : public StringsetParser {
 
 public:
 	typedef std::array<int, 2> total_order_t;
 	typedef std::array<int, 3> queue_order_t;
 
-	typedef std::pair<std::regex, total_order_t>	total_t;
-	typedef std::pair<std::regex, queue_order_t>	queue_t;
+	typedef std::pair<Matcher, total_order_t>	total_t;
+	typedef std::pair<Matcher, queue_order_t>	queue_t;
 
 	typedef std::pair<std::string, total_order_t>	total_str_t;
 	typedef std::pair<std::string, queue_order_t>	queue_str_t;
 
+	typedef int					drop_total_order_t;
+	typedef std::array<int, 2>			drop_queue_order_t;
+
+	typedef std::pair<Matcher, drop_total_order_t>	drop_total_t;
+	typedef std::pair<Matcher, drop_queue_order_t>	drop_queue_t;
+
+	typedef std::pair<std::string, drop_total_order_t>	drop_total_str_t;
+	typedef std::pair<std::string, drop_queue_order_t>	drop_queue_str_t;
+
 public:
 	static total_str_t	total_generic(void);
 	static total_str_t	total_nomatch(void);
 	static queue_str_t	queue_nomatch(void);
+	static drop_total_str_t	drop_total_generic(void);
+	static drop_total_str_t	drop_total_nomatch(void);
+	static drop_queue_str_t	drop_queue_nomatch(void);
 
 protected:
-	std::smatch     	ma;
 	total_t			total;
 	queue_t			queue;
-	std::string     	ms(size_t n);
+	drop_total_t		drop_total;
+	drop_queue_t		drop_queue;
+
+	std::string		_fingerprint;
 
 public:
 	RegexParser(const driverlist_t& drivers,
 		    const total_str_t& total,
-		    const queue_str_t& queue);
+		    const queue_str_t& queue,
+		    const drop_total_str_t& drop_total = drop_total_nomatch(),
+		    const drop_queue_str_t& drop_queue = drop_queue_nomatch());
 
 	virtual ~RegexParser() = default;
 
 	virtual bool match_total(const std::string& key, size_t value, bool& rx, bool& bytes);
 	virtual bool match_queue(const std::string& key, size_t value, bool& rx, bool& bytes, size_t& qnum);
+	virtual bool match_drop_total(const std::string& key, size_t value, bool& rx);
+	virtual bool match_drop_queue(const std::string& key, size_t value, bool& rx, size_t& qnum);
+
+	virtual std::string fingerprint() const;
 };
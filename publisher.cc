@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "publisher.h"
+#include "interface.h"
+#include "util.h"
+
+//
+// replace an existing segment of the same name, if it was left behind by
+// a publisher that's gone - it's unlinked rather than reused, so that any
+// readers it still has keep a mapping that never shrinks
+//
+void ShmPublisher::reclaim()
+{
+	auto old = ::shm_open(path.c_str(), O_RDONLY | O_CLOEXEC, 0);
+	if (old < 0) {
+		if (errno == ENOENT) return;		// it's gone already
+		throw_errno("shm_open(" + path + ")");
+	}
+
+	shm_header_t h;
+	auto n = ::pread(old, &h, sizeof h, 0);
+	::close(old);
+
+	// one that's still being set up is in use too
+	if (n != static_cast<ssize_t>(sizeof h) || memcmp(h.magic, shm_magic, sizeof shm_magic) != 0) {
+		throw std::runtime_error(path + " exists and isn't an ethq segment");
+	}
+
+	// earlier versions didn't record the publisher
+	auto pid = (h.version == shm_version) ? h.pid : 0;
+	if (pid > 0 && (::kill(pid, 0) == 0 || errno != ESRCH)) {
+		throw std::runtime_error(path + " is in use by another ethq (pid " + std::to_string(pid) + ")");
+	}
+
+	if (::shm_unlink(path.c_str()) < 0 && errno != ENOENT) {
+		throw_errno("shm_unlink(" + path + ")");
+	}
+}
+
+ShmPublisher::ShmPublisher(const std::string& name, const ifaces_t& ifaces, uint64_t interval)
+	: ifaces(ifaces), path(shm_path(name))
+{
+	//
+	// the segment must be new, so that nothing else is publishing in
+	// it - a stale one is replaced, once
+	//
+	fd = ::shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	if (fd < 0 && errno == EEXIST) {
+		reclaim();
+		fd = ::shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	}
+	if (fd < 0) {
+		throw_errno("shm_open(" + path + ")");
+	}
+
+	try {
+		reserve(4096);
+	} catch (...) {
+		::close(fd);
+		::shm_unlink(path.c_str());
+		throw;
+	}
+
+	// the magic goes in last, once the rest of the header is valid
+	auto h = header();
+	h->version = shm_version;
+	h->header_size = sizeof(shm_header_t);
+	h->nic_size = sizeof(shm_nic_t);
+	h->row_size = sizeof(shm_row_t);
+	h->size = sizeof(shm_header_t);
+	h->pid = ::getpid();
+	h->interval = interval;
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy(h->magic, shm_magic, sizeof shm_magic);
+}
+
+ShmPublisher::~ShmPublisher()
+{
+	::munmap(base, capacity);
+	::close(fd);
+	::shm_unlink(path.c_str());
+}
+
+shm_header_t* ShmPublisher::header()
+{
+	return reinterpret_cast<shm_header_t*>(base);
+}
+
+//
+// grow the segment to hold at least `size` bytes, doubling it so that
+// this is rare - it's never made smaller, so readers that still have
+// the old size mapped never touch pages that have gone
+//
+void ShmPublisher::reserve(size_t size)
+{
+	if (size <= capacity) {
+		return;
+	}
+
+	auto grown = std::max(size, capacity * 2);
+	if (::ftruncate(fd, grown) < 0) {
+		throw_errno("ftruncate(" + path + ")");
+	}
+
+	auto p = ::mmap(nullptr, grown, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED) {
+		throw_errno("mmap(" + path + ")");
+	}
+
+	// the new mapping already has the old contents
+	if (base) {
+		::munmap(base, capacity);
+	}
+
+	base = static_cast<char*>(p);
+	capacity = grown;
+}
+
+//
+// accumulate any new results, and lay out the NIC entries and rows of
+// the NICs that are still attached
+//
+void ShmPublisher::build()
+{
+	// interfaces can be added at runtime
+	if (owners.size() != ifaces.size()) {
+		totals.resize(ifaces.size());
+		stamps.resize(ifaces.size());
+		owners.resize(ifaces.size());
+	}
+
+	bool changed = false;
+	size_t nnics = 0, nrows = 0;
+
+	for (size_t n = 0; n < ifaces.size(); ++n) {
+		auto& iface = ifaces[n];
+		if (iface->detached()) continue;
+
+		auto queues = iface->queue_count();
+		auto& t = totals[n];
+		if (owners[n] != iface || t.size() != queues + 1) {
+			owners[n] = iface;
+			t.resize(queues + 1, shm_row_t { });
+		}
+
+		auto stamp = iface->timestamp();
+		bool fresh = (stamp != stamps[n]);
+		stamps[n] = stamp;
+
+		for (size_t row = 0; row <= queues; ++row) {
+			auto& stats = row ? iface->queue_stats(row - 1) : iface->total_stats();
+			auto& total = t[row];
+			total.present = stats.present;
+			if (!fresh) continue;
+			for (size_t k = 0; k < 6; ++k) {
+				total.counts[k] += stats.counts[k];
+			}
+		}
+
+		// the NIC's entry, noting any change in what it supplies
+		if (nnics == nics.size()) {
+			nics.emplace_back();
+			changed = true;
+		}
+
+		auto& nic = nics[nnics++];
+		if (strncmp(nic.name, iface->name().c_str(), sizeof nic.name) != 0 ||
+		    nic.row != nrows || nic.queues != queues)
+		{
+			changed = true;
+		}
+
+		nic = shm_nic_t { };
+		strncpy(nic.name, iface->name().c_str(), sizeof nic.name - 1);
+		strncpy(nic.driver, iface->driver().c_str(), sizeof nic.driver - 1);
+		nic.stamp = stamp;
+		nic.row = nrows;
+		nic.queues = queues;
+
+		for (const auto& total: t) {
+			if (nrows == rows.size()) {
+				rows.emplace_back();
+				changed = true;
+			}
+			changed |= (rows[nrows].present != total.present);
+			rows[nrows++] = total;
+		}
+	}
+
+	changed |= (nnics != nics.size() || nrows != rows.size());
+	nics.resize(nnics);
+	rows.resize(nrows);
+
+	if (changed) {
+		++layout;
+	}
+}
+
+//
+// NB: with a seqlock the writer never waits - the release fence after
+// making `seq` odd keeps the writes below from being seen before it,
+// and the release store that makes it even again keeps them from being
+// seen after
+//
+void ShmPublisher::update(uint64_t tick)
+{
+	build();
+
+	auto nics_size = nics.size() * sizeof(shm_nic_t);
+	auto rows_size = rows.size() * sizeof(shm_row_t);
+	auto size = sizeof(shm_header_t) + nics_size + rows_size;
+
+	reserve(size);
+
+	auto h = header();
+	auto seq = h->seq;
+	__atomic_store_n(&h->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	auto p = base + sizeof(shm_header_t);
+	memcpy(p, nics.data(), nics_size);
+	memcpy(p + nics_size, rows.data(), rows_size);
+
+	h->size = size;
+	h->tick = tick;
+	h->layout = layout;
+	h->nics = nics.size();
+	h->rows = rows.size();
+
+	__atomic_store_n(&h->seq, seq + 2, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "render.h"
+#include "shm.h"
+
+//
+// publishes each tick's samples into a POSIX shared memory segment
+// (see shm.h), so that any number of local consumers - other ethq
+// instances with -A, or anything else using ShmReader - can watch the
+// same NICs without each of them reading the counters again
+//
+// as with the Exporter the counters are running totals, kept per slot
+// so that they carry on if a NIC is replaced, and a NIC's values are
+// only added in when it has a new sample
+//
+// the segment is created afresh, and removed again by the destructor
+// - one that's in use by another running publisher isn't touched, but
+// one that was left behind by a publisher that's gone is replaced
+//
+class ShmPublisher {
+
+private:
+	const ifaces_t&			ifaces;
+	std::string			path;
+
+	int				fd = -1;
+	char*				base = nullptr;
+	size_t				capacity = 0;
+
+	// running totals, one row per NIC total and queue, and the sample they're up to
+	std::vector<std::vector<shm_row_t>>	totals;
+	std::vector<uint64_t>		stamps;
+	std::vector<std::shared_ptr<Interface>>	owners;
+
+	// the contents of the segment, as built for the latest update
+	std::vector<shm_nic_t>		nics;
+	std::vector<shm_row_t>		rows;
+	uint32_t			layout = 0;
+
+	shm_header_t*			header();
+	void				reserve(size_t size);
+	void				build();
+	void				reclaim();
+
+public:
+	// `interval` is the ns between updates, for the readers' benefit
+	ShmPublisher(const std::string& name, const ifaces_t& ifaces, uint64_t interval);
+	~ShmPublisher();
+
+	// publish the interfaces' latest results, as of `tick` (ns, CLOCK_MONOTONIC)
+	void				update(uint64_t tick);
+};
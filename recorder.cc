@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "recorder.h"
+#include "util.h"
+
+// the file is extended by (at least) this many bytes at a time
+static const size_t chunk_size = 16 << 20;
+
+Recorder::Recorder(const std::string& path, const ifaces_t& ifaces, uint64_t interval)
+	: ifaces(ifaces)
+{
+	// work out the layout
+	std::vector<Recording::iface_t> descs(ifaces.size(), Recording::iface_t { });
+	std::vector<uint32_t> masks;
+	size_t words = 1;
+
+	for (size_t n = 0; n < ifaces.size(); ++n) {
+		auto& iface = ifaces[n];
+		auto& desc = descs[n];
+
+		//
+		// room is left for the queues that are idle for now, so that
+		// they're recorded once they're active - the interfaces
+		// aren't being sampled yet, so this is safe to read
+		//
+		auto& potential = iface->potential();
+		auto rows = std::max(iface->queue_count() + 1, potential.size());
+
+		strncpy(desc.name, iface->name().c_str(), sizeof(desc.name) - 1);
+		desc.rows = rows;
+		desc.row0 = masks.size();
+		desc.offset = words;
+
+		// only the packet and byte counters are recorded
+		for (size_t row = 0; row < rows; ++row) {
+			uint32_t present = 0;
+			if (row == 0) {
+				present = iface->total_stats().present;
+			} else if (row <= iface->queue_count()) {
+				present = iface->queue_stats(row - 1).present;
+			}
+			if (row < potential.size()) {
+				present |= potential[row];
+			}
+			masks.push_back(present & 0xf);
+		}
+
+		words += 1 + rows * 4;
+	}
+
+	size_t header_size = sizeof(Recording::header_t) +
+			     descs.size() * sizeof(Recording::iface_t) +
+			     masks.size() * sizeof(uint32_t);
+	header_size = (header_size + 7) & ~7;
+
+	// create the file with its first chunk allocated
+	fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		throw_errno("open(" + path + ")");
+	}
+
+	auto size = header_size + chunk_size;
+	auto res = posix_fallocate(fd, 0, size);
+	if (res != 0) {
+		close(fd);
+		errno = res;
+		throw_errno("posix_fallocate");
+	}
+
+	auto p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED) {
+		close(fd);
+		throw_errno("mmap");
+	}
+	base = static_cast<uint8_t*>(p);
+	len = size;
+
+	// fill in the header
+	hdr = reinterpret_cast<Recording::header_t*>(base);
+	memcpy(hdr->magic, Recording::magic, sizeof hdr->magic);
+	hdr->version = Recording::version;
+	hdr->ifcount = descs.size();
+	hdr->header_size = header_size;
+	hdr->record_size = words * sizeof(uint64_t);
+	hdr->count = 0;
+	hdr->interval = interval;
+	hdr->epoch = clock_ns(CLOCK_REALTIME) - clock_ns(CLOCK_MONOTONIC);
+
+	auto ifs = reinterpret_cast<Recording::iface_t*>(hdr + 1);
+	std::copy(descs.begin(), descs.end(), ifs);
+	std::copy(masks.begin(), masks.end(), reinterpret_cast<uint32_t*>(ifs + descs.size()));
+
+	//
+	// the first record holds the (zero) counts as of the initial
+	// sample that each interface took when it was opened, giving
+	// the baseline for the rates over the first tick
+	//
+	record.assign(words, 0);
+	stamps.resize(ifaces.size());
+	for (size_t n = 0; n < ifaces.size(); ++n) {
+		stamps[n] = ifaces[n]->timestamp();
+		record[descs[n].offset] = stamps[n];
+	}
+
+	append(clock_ns());
+}
+
+Recorder::~Recorder()
+{
+	// drop any unused preallocated space
+	auto used = hdr->header_size + hdr->count * hdr->record_size;
+	munmap(base, len);
+	if (ftruncate(fd, used) < 0) {
+		// nothing to be done - the header still says what's valid
+	}
+	close(fd);
+}
+
+void Recorder::grow()
+{
+	auto size = len + std::max(chunk_size, static_cast<size_t>(hdr->record_size));
+
+	auto res = posix_fallocate(fd, len, size - len);
+	if (res != 0) {
+		errno = res;
+		throw_errno("posix_fallocate");
+	}
+
+	auto p = mremap(base, len, size, MREMAP_MAYMOVE);
+	if (p == MAP_FAILED) {
+		throw_errno("mremap");
+	}
+
+	base = static_cast<uint8_t*>(p);
+	len = size;
+	hdr = reinterpret_cast<Recording::header_t*>(base);
+}
+
+void Recorder::append(uint64_t tick)
+{
+	auto ifs = reinterpret_cast<const Recording::iface_t*>(hdr + 1);
+
+	record[0] = tick;
+
+	//
+	// add in the results from any interface that has published new
+	// ones since the last record - a NIC may have fewer queues now
+	// than when the recording started, but never more rows than the
+	// recording has room for
+	//
+	// NB: the interfaces are fixed when the recording starts, so any
+	// that are added later (with -a) aren't recorded
+	//
+	auto count = std::min(ifaces.size(), static_cast<size_t>(hdr->ifcount));
+	for (size_t n = 0; n < count; ++n) {
+		auto& iface = ifaces[n];
+		auto stamp = iface->timestamp();
+		if (stamp == stamps[n]) {
+			continue;
+		}
+		stamps[n] = stamp;
+
+		auto p = &record[ifs[n].offset];
+		*p++ = stamp;
+
+		auto rows = std::min(static_cast<size_t>(ifs[n].rows), iface->queue_count() + 1);
+		for (size_t row = 0; row < rows; ++row, p += 4) {
+			auto& stats = row ? iface->queue_stats(row - 1) : iface->total_stats();
+			for (size_t i = 0; i < 4; ++i) {
+				p[i] += stats.counts[i];
+			}
+		}
+	}
+
+	auto records = hdr->count;
+	auto offset = hdr->header_size + records * hdr->record_size;
+	if (offset + hdr->record_size > len) {
+		grow();
+	}
+
+	memcpy(base + offset, record.data(), hdr->record_size);
+	__atomic_store_n(&hdr->count, records + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "interface.h"
+#include "recording.h"
+
+//
+// appends one record per tick to a file in the format described in
+// recording.h
+//
+// the file is extended (and the disk space allocated) in large chunks
+// and written through a shared memory mapping, so recording a tick is
+// just a copy of the latest counters - it's trimmed to the records
+// actually written when the recorder is destroyed, but it's readable
+// at any time since the header only ever counts complete records
+//
+class Recorder {
+
+public:
+	typedef std::vector<std::shared_ptr<Interface>> ifaces_t;
+
+private:
+	// the interfaces as at the start of the recording
+	const ifaces_t			ifaces;
+
+	int				fd = -1;
+	uint8_t*			base = nullptr;
+	size_t				len = 0;
+	Recording::header_t*		hdr = nullptr;
+
+	// the running totals, laid out exactly as in a record
+	std::vector<uint64_t>		record;
+
+	// the sample time of the results last added to the totals
+	std::vector<uint64_t>		stamps;
+
+	void				grow();
+
+public:
+	Recorder(const std::string& path, const ifaces_t& ifaces, uint64_t interval);
+	~Recorder();
+
+	// append the interfaces' current results
+	void				append(uint64_t tick);
+};
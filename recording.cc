@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "recording.h"
+#include "util.h"
+
+const char Recording::magic[8] = { 'E', 'T', 'H', 'Q', 'R', 'E', 'C', 0 };
+
+Recording::Recording(const std::string& path)
+{
+	fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		throw_errno("open(" + path + ")");
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) < 0) {
+		close(fd);
+		throw_errno("fstat");
+	}
+
+	len = st.st_size;
+	if (len < sizeof(header_t)) {
+		close(fd);
+		throw std::runtime_error(path + " is not an ethq recording");
+	}
+
+	auto p = mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED) {
+		close(fd);
+		throw_errno("mmap");
+	}
+	base = static_cast<const uint8_t*>(p);
+	hdr = reinterpret_cast<const header_t*>(base);
+
+	std::string error;
+	if (memcmp(hdr->magic, magic, sizeof magic) != 0) {
+		error = " is not an ethq recording";
+	} else if (hdr->version != version) {
+		error = " has unsupported version " + std::to_string(hdr->version);
+	} else if (hdr->header_size > len || hdr->record_size == 0 ||
+		   sizeof(header_t) + hdr->ifcount * sizeof(iface_t) > hdr->header_size) {
+		error = " is truncated or corrupt";
+	}
+
+	if (!error.empty()) {
+		munmap(p, len);
+		close(fd);
+		throw std::runtime_error(path + error);
+	}
+
+	ifs = reinterpret_cast<const iface_t*>(hdr + 1);
+	masks = reinterpret_cast<const uint32_t*>(ifs + hdr->ifcount);
+
+	// every interface's rows must lie within the header and records
+	size_t mask_end = reinterpret_cast<const uint8_t*>(masks) - base;
+	for (size_t n = 0; n < hdr->ifcount; ++n) {
+		auto& iface = ifs[n];
+		if (mask_end + (iface.row0 + iface.rows) * sizeof(uint32_t) > hdr->header_size ||
+		    (iface.offset + 1 + iface.rows * 4) * sizeof(uint64_t) > hdr->record_size)
+		{
+			munmap(p, len);
+			close(fd);
+			throw std::runtime_error(path + " is truncated or corrupt");
+		}
+	}
+}
+
+Recording::~Recording()
+{
+	munmap(const_cast<uint8_t*>(base), len);
+	close(fd);
+}
+
+//
+// the writer may still be appending, so only count records that
+// are both complete and inside the part of the file we mapped
+//
+size_t Recording::count() const
+{
+	size_t n = __atomic_load_n(&hdr->count, __ATOMIC_ACQUIRE);
+	return std::min(n, (len - hdr->header_size) / hdr->record_size);
+}
+
+const uint64_t* Recording::record(size_t n) const
+{
+	return reinterpret_cast<const uint64_t*>(base + hdr->header_size + n * hdr->record_size);
+}
+
+uint32_t Recording::present(size_t n, size_t row) const
+{
+	return masks[ifs[n].row0 + row];
+}
+
+uint64_t Recording::tick(size_t rec) const
+{
+	return record(rec)[0];
+}
+
+uint64_t Recording::stamp(size_t rec, size_t n) const
+{
+	return record(rec)[ifs[n].offset];
+}
+
+const uint64_t* Recording::counts(size_t rec, size_t n, size_t row) const
+{
+	return record(rec) + ifs[n].offset + 1 + row * 4;
+}
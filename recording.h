@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//
+// the binary file format written by `ethq --record`, and a read-only
+// memory mapped view of such a file
+//
+// the file starts with a header_t, followed by an iface_t for each
+// recorded interface and then the `present` bitmask of every row of
+// every interface, padded to a multiple of eight bytes
+//
+// that's followed by fixed size records, one per tick, each of which
+// is a sequence of 64-bit words:
+//
+//   tick time (ns, CLOCK_MONOTONIC)
+//   for each interface, at word `iface_t::offset`:
+//     sample time (ns, CLOCK_MONOTONIC)
+//     for each row (total, then queues):
+//       tx packets, rx packets, tx bytes, rx bytes
+//
+// the counts are cumulative since recording started, so the rate over
+// any span is just the difference between two records - if a NIC's
+// sample wasn't ready in time for a tick its values and sample time
+// are simply repeated
+//
+// the file is preallocated in large chunks, so `count` (which is only
+// updated once each record is complete) says how many are valid
+//
+class Recording {
+
+public:
+	static const uint32_t	version = 1;
+
+	struct header_t {
+		char		magic[8];
+		uint32_t	version;
+		uint32_t	ifcount;
+		uint32_t	header_size;	// bytes, including ifaces and masks
+		uint32_t	record_size;	// bytes
+		uint64_t	count;		// complete records
+		uint64_t	interval;	// ns
+		int64_t		epoch;		// CLOCK_REALTIME - CLOCK_MONOTONIC, ns
+	};
+
+	struct iface_t {
+		char		name[16];
+		uint32_t	rows;
+		uint32_t	row0;		// index of first `present` mask
+		uint32_t	offset;		// in words, from start of record
+		uint32_t	reserved;
+	};
+
+	static const char	magic[8];
+
+private:
+	int			fd = -1;
+	const uint8_t*		base = nullptr;
+	size_t			len = 0;
+
+	const header_t*		hdr = nullptr;
+	const iface_t*		ifs = nullptr;
+	const uint32_t*		masks = nullptr;
+
+	const uint64_t*		record(size_t n) const;
+
+public:
+	Recording(const std::string& path);
+	~Recording();
+
+public:
+	size_t			count() const;
+	uint64_t		interval() const	{ return hdr->interval; };
+	int64_t			epoch() const		{ return hdr->epoch; };
+
+	size_t			iface_count() const	{ return hdr->ifcount; };
+	const iface_t&		iface(size_t n) const	{ return ifs[n]; };
+	uint32_t		present(size_t n, size_t row) const;
+
+	uint64_t		tick(size_t rec) const;
+	uint64_t		stamp(size_t rec, size_t n) const;
+	const uint64_t*		counts(size_t rec, size_t n, size_t row) const;
+};
@@ -0,0 +1,511 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+#include <net/if.h>
+#include <ncurses.h>
+
+#include "render.h"
+#include "format.h"
+
+static const std::array<size_t, out_cols> cols = { IFNAMSIZ, 8, 8, 10, 10, 10, 10, 8, 8, 8, 6, 6, 7, 5, 4, 5, 8, 8 };
+static const size_t rate_cols = 9;
+static const size_t balance_cols = out_cols - irq_cols;
+
+size_t format_hdr(char* line, const std::array<const char*, out_cols>& hdrs, bool irqs)
+{
+	auto p = line;
+	for (size_t n = 0; n < (irqs ? out_cols : balance_cols); ++n) {
+		if (n) *p++ = ' ';
+		p = fmt_right(p, cols[n], hdrs[n], strlen(hdrs[n]));
+	}
+	return p - line;
+}
+
+//
+// counts are converted to per-second rates using the measured time
+// between the two samples (in seconds), not the nominal interval
+//
+size_t format_row(char* line, const char* label, size_t len,
+		  const Interface::ifstats_t& stats, double interval, bool si)
+{
+	auto p = fmt_right(line, cols[0], label, len);
+	auto& q = stats.counts;
+	char num[fmt_max];
+
+	for (size_t n = 1; n < rate_cols; ++n) {
+
+		// packets and bytes, then the bytes again as bits, then drops
+		auto k = (n < 5) ? n - 1 : n - 3;
+		auto bits = (n == 5 || n == 6);
+		auto e = num;
+
+		if (!stats.has(k) || !(interval > 0)) {
+			*e++ = '-';
+		} else if (!bits) {
+			auto rate = q[k] / interval;
+			e = si ? fmt_si(e, rate) : fmt_u64(e, static_cast<uint64_t>(rate + 0.5));
+		} else if (si) {
+			e = fmt_si(e, q[k] * 8 / interval);
+		} else {
+			auto mbps = q[k] * 8 / 1e6;
+			mbps /= interval;
+			e = fmt_fixed(e, mbps, 3);
+		}
+
+		*p++ = ' ';
+		p = fmt_right(p, cols[n], num, e - num);
+	}
+
+	return p - line;
+}
+
+//
+// appended to a totals row - the busiest queue's share relative to the
+// mean, the coefficient of variation, the busiest queue and the number
+// of idle queues - or just blanks for a queue row
+//
+size_t format_balance(char* line, const Interface::balance_t* b)
+{
+	auto p = line;
+	char num[fmt_max];
+
+	for (size_t n = rate_cols; n < balance_cols; ++n) {
+		auto e = num;
+
+		if (!b) {
+			// leave it blank
+		} else if (!b->valid) {
+			*e++ = '-';
+		} else if (n == rate_cols) {
+			e = fmt_fixed(e, b->ratio, 2);
+		} else if (n == rate_cols + 1) {
+			e = fmt_fixed(e, b->cv, 2);
+		} else if (n == rate_cols + 2) {
+			e = fmt_u64(e, b->hottest);
+		} else {
+			e = fmt_u64(e, b->idle);
+		}
+
+		*p++ = ' ';
+		p = fmt_right(p, cols[n], num, e - num);
+	}
+
+	return p - line;
+}
+
+size_t format_irqs(char* line, const IrqMap& irqs, size_t nic, long queue, bool si)
+{
+	auto p = line;
+	char num[fmt_max];
+
+	auto q = (queue >= 0) ? irqs.queue(nic, queue) : nullptr;
+
+	auto rate = [&](char* e, double v) {
+		return si ? fmt_si(e, v) : fmt_u64(e, static_cast<uint64_t>(v + 0.5));
+	};
+
+	for (size_t n = balance_cols; n < out_cols; ++n) {
+		auto e = num;
+		auto col = n - balance_cols;
+
+		if (queue < 0) {
+			if (col == 2 && irqs.node(nic) >= 0) {
+				e = fmt_u64(e, irqs.node(nic));
+			} else if (col == 3 && irqs.rate(nic) >= 0) {
+				e = rate(e, irqs.rate(nic));
+			} else {
+				*e++ = '-';
+			}
+		} else if (!q || (col == 0 && q->irqs.empty()) || (col != 0 && q->cpu < 0) ||
+			   (col == 2 && q->node < 0) || (col == 3 && q->irqs.empty()))
+		{
+			*e++ = '-';
+		} else if (col == 0) {
+			e = fmt_u64(e, q->irqs[0]);
+		} else if (col == 1) {
+			e = fmt_u64(e, q->cpu);
+		} else if (col == 2) {
+			// marked if it's not the NIC's own node
+			e = fmt_u64(e, q->node);
+			if (q->remote) *e++ = '*';
+		} else if (col == 3) {
+			e = rate(e, q->rate);
+		} else {
+			e = rate(e, irqs.softirq_rate(q->cpu));
+		}
+
+		*p++ = ' ';
+		p = fmt_right(p, cols[n], num, e - num);
+	}
+
+	return p - line;
+}
+
+static const char* sort_names[] = {
+	"txpps", "rxpps", "txbps", "rxbps", "txdrop", "rxdrop"
+};
+
+int view_t::parse_sort(const std::string& name)
+{
+	if (name == "queue") {
+		return -1;
+	}
+
+	for (size_t k = 0; k < sizeof sort_names / sizeof sort_names[0]; ++k) {
+		if (name == sort_names[k]) {
+			return k;
+		}
+	}
+
+	throw std::runtime_error("unknown sort order: " + name);
+}
+
+const char* view_t::sort_name(int sort)
+{
+	return (sort < 0) ? "queue" : sort_names[sort];
+}
+
+size_t order_queues(const Interface& iface, const view_t& view, std::vector<uint32_t>& order)
+{
+	auto n = iface.queue_count();
+	auto shown = view.shown(n);
+
+	order.resize(n);
+	std::iota(order.begin(), order.end(), 0);
+
+	if (view.sort >= 0) {
+		auto k = static_cast<size_t>(view.sort);
+		auto value = [&](uint32_t q) -> uint64_t {
+			auto& stats = iface.queue_stats(q);
+			return stats.has(k) ? stats.counts[k] : 0;
+		};
+
+		std::partial_sort(order.begin(), order.begin() + shown, order.end(), [&](uint32_t a, uint32_t b) {
+			auto va = value(a), vb = value(b);
+			return (va != vb) ? (va > vb) : (a < b);
+		});
+	}
+
+	return shown;
+}
+
+//
+// the rows are shown in the Rollup's order if there is one, and
+// otherwise that of the NICs
+//
+static size_t entry_count(const ifaces_t& ifaces, const Rollup* rollup)
+{
+	return rollup ? rollup->order().size() : ifaces.size();
+}
+
+static Rollup::entry_t entry_at(const Rollup* rollup, size_t e)
+{
+	return rollup ? rollup->order()[e] : Rollup::entry_t{ -1, e, false };
+}
+
+bool WindowRenderer::key(int ch)
+{
+	// receive before transmit, as that's where the trouble usually is
+	static const int sorts[] = { -1, 1, 0, 3, 2, 5, 4 };
+	static const size_t nsorts = sizeof sorts / sizeof sorts[0];
+	static const size_t tops[] = { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000 };
+
+	switch (ch) {
+		case 'o':
+		case 'O': {
+			auto i = std::find(sorts, sorts + nsorts, view.sort) - sorts;
+			i = (ch == 'o') ? (i + 1) % nsorts : (i + nsorts - 1) % nsorts;
+			view.sort = sorts[i];
+			offset = 0;
+			break;
+		}
+		case '+': {
+			if (!view.top) return false;
+			auto t = std::upper_bound(std::begin(tops), std::end(tops), view.top);
+			view.top = (t == std::end(tops) || *t >= most) ? 0 : *t;
+			break;
+		}
+		case '-': {
+			auto current = view.top ? view.top : most;
+			auto t = std::lower_bound(std::begin(tops), std::end(tops), current);
+			view.top = (t == std::begin(tops)) ? tops[0] : *(t - 1);
+			break;
+		}
+		case ' ':
+		case KEY_NPAGE:
+			offset += page;
+			break;
+		case KEY_PPAGE:
+			offset -= std::min(offset, page);
+			break;
+		case KEY_DOWN:
+			++offset;
+			break;
+		case KEY_UP:
+			if (offset) --offset;
+			break;
+		case KEY_HOME:
+			offset = 0;
+			break;
+		case 'c':
+			collapsed = !collapsed;
+			break;
+		case KEY_RESIZE:
+			break;
+		default:
+			return false;
+	}
+
+	return true;
+}
+
+void WindowRenderer::put(int row, const char* s, size_t len, unsigned attr)
+{
+	if (row < rows) {
+		memcpy(&cells[row * cols], s, std::min(len, static_cast<size_t>(cols)));
+		attrs[row] = attr;
+	}
+}
+
+void WindowRenderer::draw(WINDOW* w, const ifaces_t& ifaces, const char* timebuf, bool si,
+			  const IrqMap* irqs, const Rollup* rollup, const char* footer)
+{
+	static const std::array<const char*, out_cols> headers[2] = {
+		{ "NIC", "TX pkts", "RX pkts", "TX bytes", "RX bytes", "TX Mbps", "RX Mbps", "TX drops", "RX drops", "RX skew", "RX cv", "RX hot", "RX idle",
+		  "IRQ", "CPU", "node", "IRQ/s", "SIRQ/s" },
+		{ "NIC", "TX pps", "RX pps", "TX B/s", "RX B/s", "TX bps", "RX bps", "TX drops", "RX drops", "RX skew", "RX cv", "RX hot", "RX idle",
+		  "IRQ", "CPU", "node", "IRQ/s", "SIRQ/s" }
+	};
+
+	// start afresh if the window size has changed
+	if (getmaxy(w) != rows || getmaxx(w) != cols) {
+		rows = getmaxy(w);
+		cols = getmaxx(w);
+		cells.assign(rows * cols, ' ');
+		shown.assign(rows * cols, '\0');
+		attrs.assign(rows, A_NORMAL);
+		shown_attrs.assign(rows, ~0U);
+	}
+
+	std::fill(cells.begin(), cells.end(), ' ');
+	std::fill(attrs.begin(), attrs.end(), A_NORMAL);
+
+	char line[out_max];
+
+	//
+	// the rows below the header are scrolled as one, so first find how
+	// many there are - a status line is added at the bottom if the view
+	// isn't the default or they don't all fit, above the caller's footer
+	// line if there is one
+	//
+	size_t total = 0;
+	most = 0;
+	for (size_t e = 0, n = entry_count(ifaces, rollup); e < n; ++e) {
+		auto entry = entry_at(rollup, e);
+		if (entry.group >= 0) {
+			++total;
+			continue;
+		}
+
+		auto& iface = ifaces[entry.nic];
+		if (iface->detached() || (collapsed && entry.member)) continue;
+		auto queues = iface->queue_count();
+		total += 1 + view.shown(queues);
+		most = std::max(most, queues);
+	}
+
+	auto room = static_cast<size_t>(std::max(rows - (footer ? 2 : 1), 0));
+	auto status = (view.sort >= 0 || view.top || total > room) && room > 1;
+	page = status ? room - 1 : room;
+	offset = std::min(offset, (total > page) ? total - page : 0);
+
+	// the header, with the time over the left of it
+	put(0, line, format_hdr(line, headers[si], irqs), A_REVERSE);
+	if (rows > 0 && cols > 2) {
+		memcpy(&cells[2], timebuf, std::min(strlen(timebuf), static_cast<size_t>(cols - 2)));
+	}
+
+	// index of the next row below the header, visible or not
+	size_t index = 0;
+	auto end = offset + page;
+	auto row = [&]() { return static_cast<int>(1 + index - offset); };
+
+	for (size_t e = 0, n = entry_count(ifaces, rollup); e < n && index < end; ++e) {
+		auto entry = entry_at(rollup, e);
+
+		if (entry.group >= 0) {
+			if (index >= offset) {
+				auto& group = rollup->groups()[entry.group];
+				auto len = format_row(line, group.name.c_str(), group.name.size(), group.stats, group.interval, si);
+				put(row(), line, len, A_BOLD | A_UNDERLINE);
+			}
+			++index;
+			continue;
+		}
+
+		auto nic = entry.nic;
+		auto& iface = ifaces[nic];
+		if (iface->detached() || (collapsed && entry.member)) continue;
+
+		// skip a NIC that's wholly scrolled off the top
+		auto shown = view.shown(iface->queue_count());
+		if (index + 1 + shown <= offset) {
+			index += 1 + shown;
+			continue;
+		}
+
+		// totals
+		auto interval = iface->interval();
+		if (index >= offset) {
+			auto& name = iface->name();
+			auto len = format_row(line, name.c_str(), name.size(), iface->total_stats(), interval, si);
+			len += format_balance(line + len, &iface->balance(true));
+			if (irqs) {
+				len += format_irqs(line + len, *irqs, nic, -1, si);
+			}
+			put(row(), line, len, A_BOLD);
+		}
+		++index;
+
+		// per-queue data
+		order_queues(*iface, view, order);
+		for (size_t j = 0; j < shown && index < end; ++j, ++index) {
+			if (index < offset) continue;
+
+			auto i = order[j];
+			char label[fmt_max];
+			auto len = format_row(line, label, fmt_u64(label, i) - label, iface->queue_stats(i), interval, si);
+			if (irqs) {
+				len += format_balance(line + len, nullptr);
+				len += format_irqs(line + len, *irqs, nic, i, si);
+			}
+			put(row(), line, len, A_NORMAL);
+		}
+	}
+
+	if (status) {
+		char top[fmt_max + 1] = "all";
+		if (view.top) {
+			*fmt_u64(top, view.top) = '\0';
+		}
+
+		auto len = snprintf(line, sizeof line,
+				    " sort: %s  top: %s  rows %zu-%zu of %zu  [o/O] sort  [+/-] top  [PgUp/PgDn] scroll  [q] quit",
+				    view_t::sort_name(view.sort), top, total ? offset + 1 : 0,
+				    std::min(offset + page, total), total);
+		put(1 + page, line, std::min(static_cast<size_t>(len), sizeof line - 1), A_REVERSE);
+	}
+
+	if (footer && rows > 1) {
+		put(rows - 1, footer, strlen(footer), A_REVERSE);
+	}
+
+	//
+	// send the runs of changed cells in each row, or the whole row
+	// if its attributes have changed
+	//
+	for (int r = 0; r < rows; ++r) {
+		auto c = &cells[r * cols];
+		auto s = &shown[r * cols];
+
+		wattrset(w, attrs[r]);
+
+		if (attrs[r] != shown_attrs[r]) {
+			mvwaddnstr(w, r, 0, c, cols);
+			continue;
+		}
+
+		for (int x = 0; x < cols; ) {
+			if (c[x] == s[x]) {
+				++x;
+				continue;
+			}
+
+			auto start = x;
+			while (x < cols && c[x] != s[x]) ++x;
+			mvwaddnstr(w, r, start, c + start, x - start);
+		}
+	}
+
+	wattrset(w, A_NORMAL);
+	shown.swap(cells);
+	shown_attrs.swap(attrs);
+
+	wrefresh(w);
+}
+
+//
+// the whole frame is written with a single flush
+//
+void render_text(std::ostream& out, const ifaces_t& ifaces, bool si, const IrqMap* irqs,
+		 const view_t& view, const Rollup* rollup)
+{
+	static std::vector<uint32_t> order;
+
+	static const std::array<const char*, out_cols> headers[2] = {
+		{ "nic", "txp", "rxp", "txb", "rxb", "txmbps", "rxmbps", "txdrop", "rxdrop", "rxskew", "rxcv", "rxhot", "rxidle",
+		  "irq", "cpu", "node", "irqps", "sirqps" },
+		{ "nic", "txpps", "rxpps", "txBps", "rxBps", "txbps", "rxbps", "txdrop", "rxdrop", "rxskew", "rxcv", "rxhot", "rxidle",
+		  "irq", "cpu", "node", "irqps", "sirqps" }
+	};
+
+	char line[out_max];
+	auto len = format_hdr(line, headers[si], irqs);
+	line[len++] = '\n';
+	out.write(line, len);
+
+	for (size_t e = 0, n = entry_count(ifaces, rollup); e < n; ++e) {
+		auto entry = entry_at(rollup, e);
+
+		if (entry.group >= 0) {
+			auto& group = rollup->groups()[entry.group];
+			len = format_row(line, group.name.c_str(), group.name.size(), group.stats, group.interval, si);
+			line[len++] = '\n';
+			out.write(line, len);
+			continue;
+		}
+
+		auto nic = entry.nic;
+		auto& iface = ifaces[nic];
+		if (iface->detached()) continue;
+
+		auto& name = iface->name();
+		auto interval = iface->interval();
+
+		len = format_row(line, name.c_str(), name.size(), iface->total_stats(), interval, si);
+		len += format_balance(line + len, &iface->balance(true));
+		if (irqs) {
+			len += format_irqs(line + len, *irqs, nic, -1, si);
+		}
+		line[len++] = '\n';
+		out.write(line, len);
+
+		for (size_t j = 0, n = order_queues(*iface, view, order); j < n; ++j) {
+			auto i = order[j];
+			char label[fmt_max];
+			len = format_row(line, label, fmt_u64(label, i) - label, iface->queue_stats(i), interval, si);
+			if (irqs) {
+				len += format_balance(line + len, nullptr);
+				len += format_irqs(line + len, *irqs, nic, i, si);
+			}
+			line[len++] = '\n';
+			out.write(line, len);
+		}
+	}
+
+	out << std::endl;
+}
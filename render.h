@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "interface.h"
+#include "irqmap.h"
+#include "rollup.h"
+
+// as per <ncurses.h>, which needn't be dragged in here
+typedef struct _win_st WINDOW;
+
+//
+// formatting of the per-second rates for display, in either the
+// curses window or the scrolling text mode
+//
+// with `si` set the rates are shown to three significant figures
+// with SI multipliers (e.g. 1.23M pps, 45.6G bps) instead of in full
+//
+
+typedef std::vector<std::shared_ptr<Interface>> ifaces_t;
+
+//
+// the name, the six throughput rates, the two drop rates and then the
+// four measures of how evenly the NIC's received packets are spread
+// over its queues, which are only shown in the totals rows
+//
+// with an IrqMap, those are followed by each queue's interrupt, its
+// CPU and NUMA node, its interrupt rate and the CPU's network softirq
+// rate, and the NIC's own node and total interrupt rate
+//
+static const size_t out_cols = 18;
+static const size_t irq_cols = 5;
+
+// enough room for any one formatted row
+static const size_t out_max = 512;
+
+extern size_t format_hdr(char* line, const std::array<const char*, out_cols>& hdrs, bool irqs = false);
+extern size_t format_row(char* line, const char* label, size_t len,
+			 const Interface::ifstats_t& stats, double interval, bool si);
+extern size_t format_balance(char* line, const Interface::balance_t* balance);
+extern size_t format_irqs(char* line, const IrqMap& irqs, size_t nic, long queue, bool si);
+
+//
+// which of each NIC's queues are shown and in what order - by default
+// all of them by number, otherwise the busiest first by one of the six
+// counts (indexed as per Interface::ifstats_t), and optionally just the
+// `top` of them
+//
+struct view_t {
+	int				sort = -1;	// or -1 for queue order
+	size_t				top = 0;	// or 0 for all
+
+	// the number of rows shown for a NIC with `n` queues
+	size_t				shown(size_t n) const {
+		return top ? std::min(top, n) : n;
+	}
+
+	// parses "queue" or one of the text mode headers, e.g. "rxpps"
+	static int			parse_sort(const std::string& name);
+	static const char*		sort_name(int sort);
+};
+
+//
+// puts the numbers of the queues to be shown into `order`, which is
+// reused from one tick to the next - only the shown queues are sorted,
+// with a partial sort over the latest deltas, and ties go to the lower
+// numbered queue so that idle queues don't jump around
+//
+extern size_t order_queues(const Interface& iface, const view_t& view, std::vector<uint32_t>& order);
+
+//
+// draws the rows into a cell buffer, and then sends to curses just
+// those cells that differ from the previous frame, so an unchanged
+// cell costs a byte comparison instead of a call into curses and a
+// full-screen erase is only needed when the window changes size
+//
+class WindowRenderer {
+
+private:
+	int				rows = 0;
+	int				cols = 0;
+
+	std::vector<char>		cells;
+	std::vector<char>		shown;
+	std::vector<unsigned>		attrs;
+	std::vector<unsigned>		shown_attrs;
+
+	// the view's scroll position in rows below the header, and how
+	// many rows the last frame had room for
+	size_t				offset = 0;
+	size_t				page = 0;
+	size_t				most = 0;	// queues on the widest NIC
+	bool				collapsed = false;	// bonds' members hidden
+	std::vector<uint32_t>		order;
+
+	void				put(int row, const char* s, size_t len, unsigned attr);
+
+public:
+	view_t				view;
+
+	//
+	// changes the view for a key - 'o' and 'O' step through the sort
+	// orders, '+' and '-' show more or fewer queues, 'c' collapses or
+	// expands the bonds, and the arrow, page and home keys scroll -
+	// returning true if it needs a redraw
+	//
+	bool				key(int ch);
+
+	void				draw(WINDOW* w, const ifaces_t& ifaces, const char* timebuf, bool si = false,
+					     const IrqMap* irqs = nullptr, const Rollup* rollup = nullptr,
+					     const char* footer = nullptr);
+};
+
+extern void render_text(std::ostream& out, const ifaces_t& ifaces, bool si = false,
+			const IrqMap* irqs = nullptr, const view_t& view = view_t(),
+			const Rollup* rollup = nullptr);
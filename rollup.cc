@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <set>
+
+#include <unistd.h>
+
+#include "rollup.h"
+#include "ethtool++.h"
+
+static const size_t ncounts = sizeof(Interface::ifstats_t::counts) / sizeof(uint64_t);
+
+static std::string read_line(const std::string& path)
+{
+	std::ifstream in(path);
+	std::string line;
+	std::getline(in, line);
+	return line;
+}
+
+// the link that the NIC is enslaved to, if any
+static std::string master_of(const std::string& name)
+{
+	char buf[PATH_MAX];
+	auto n = ::readlink(("/sys/class/net/" + name + "/master").c_str(), buf, sizeof buf - 1);
+	if (n <= 0) {
+		return std::string();
+	}
+
+	std::string master(buf, n);
+	master.erase(0, master.rfind('/') + 1);
+	return master;
+}
+
+// the bond or team that the NIC is enslaved to, if any
+static std::string bond_of(const std::string& name)
+{
+	auto master = master_of(name);
+	if (master.empty()) {
+		return master;
+	}
+
+	// bridges and the like are masters too
+	try {
+		auto driver = Ethtool(master).driver();
+		if (driver == "bonding" || driver == "team") {
+			return master;
+		}
+	} catch (...) {
+	}
+
+	return std::string();
+}
+
+// a virtual device sits under the one with the node, as in IrqMap
+static int node_of(const std::string& name)
+{
+	auto dev = "/sys/class/net/" + name + "/device";
+	for (auto dir: { dev, dev + "/.." }) {
+		auto node = read_line(dir + "/numa_node");
+		if (!node.empty()) {
+			return atoi(node.c_str());
+		}
+	}
+	return -1;
+}
+
+//
+// only physical ports count towards the nodes and the host, as the
+// traffic of a bond, VLAN, bridge or veth is also that of a port -
+// a link with no sysfs entry at all (e.g. a simulated NIC) counts too
+//
+static bool is_port(const std::string& name)
+{
+	auto dir = "/sys/class/net/" + name;
+	return ::access(dir.c_str(), F_OK) < 0 || ::access((dir + "/device").c_str(), F_OK) == 0;
+}
+
+Rollup::Rollup(const std::vector<std::shared_ptr<Interface>>& ifaces)
+	: ifaces(ifaces)
+{
+	map();
+}
+
+void Rollup::map()
+{
+	std::map<std::string, size_t> bonds;
+	std::map<int, std::vector<size_t>> nodes;
+	std::vector<size_t> all;
+	std::vector<entry_t> members;
+
+	_groups.clear();
+	_order.clear();
+
+	// the links that are the masters of others being monitored
+	std::set<std::string> masters;
+	for (const auto& iface: ifaces) {
+		if (!iface->detached()) {
+			masters.insert(master_of(iface->name()));
+		}
+	}
+
+	for (size_t i = 0; i < ifaces.size(); ++i) {
+		auto& name = ifaces[i]->name();
+		if (ifaces[i]->detached()) continue;
+
+		if (!masters.count(name) && is_port(name)) {
+			all.push_back(i);
+
+			auto node = node_of(name);
+			if (node >= 0) {
+				nodes[node].push_back(i);
+			}
+		}
+
+		auto bond = bond_of(name);
+		if (bond.empty()) {
+			_order.push_back({ -1, i, false });
+			continue;
+		}
+
+		auto iter = bonds.find(bond);
+		if (iter == bonds.end()) {
+			iter = bonds.emplace(bond, _groups.size()).first;
+			_groups.push_back({ BOND, bond, { }, { }, 0 });
+		}
+		_groups[iter->second].members.push_back(i);
+	}
+
+	for (size_t g = 0; g < _groups.size(); ++g) {
+		_order.push_back({ static_cast<long>(g), 0, false });
+		for (auto i: _groups[g].members) {
+			_order.push_back({ -1, i, true });
+		}
+	}
+
+	auto add = [&](kind_t kind, const std::string& name, const std::vector<size_t>& nics) {
+		_order.push_back({ static_cast<long>(_groups.size()), 0, false });
+		_groups.push_back({ kind, name, nics, { }, 0 });
+	};
+
+	if (nodes.size() > 1) {
+		for (const auto& node: nodes) {
+			add(NODE, "node" + std::to_string(node.first), node.second);
+		}
+	}
+
+	if (all.size() > 1) {
+		add(HOST, "host", all);
+	}
+}
+
+void Rollup::refresh()
+{
+	for (auto& group: _groups) {
+		auto& stats = group.stats;
+		stats = { };
+		group.interval = 0;
+
+		size_t n = 0;
+		for (auto i: group.members) {
+			auto& iface = *ifaces[i];
+			if (iface.detached() || !(iface.interval() > 0)) continue;
+			group.interval += iface.interval();
+			++n;
+		}
+
+		if (!n) continue;
+		group.interval /= n;
+
+		stats.present = ~0U;
+		for (auto i: group.members) {
+			auto& iface = *ifaces[i];
+			if (iface.detached() || !(iface.interval() > 0)) continue;
+
+			auto& total = iface.total_stats();
+			auto scale = group.interval / iface.interval();
+			for (size_t k = 0; k < ncounts; ++k) {
+				stats.counts[k] += static_cast<uint64_t>(total.counts[k] * scale + 0.5);
+			}
+			stats.present &= total.present;
+		}
+	}
+}
+
+const std::vector<Rollup::group_t>& Rollup::groups() const
+{
+	return _groups;
+}
+
+const std::vector<Rollup::entry_t>& Rollup::order() const
+{
+	return _order;
+}
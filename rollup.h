@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "interface.h"
+
+//
+// totals for groups of NICs - each bond (or team) that any of them are
+// enslaved to, each NUMA node if they're on more than one, and the whole
+// host if there's more than one NIC - added up from the members' latest
+// deltas
+//
+// the groups are found from sysfs at startup, and again whenever the
+// set of NICs changes - a NIC's bond is its `master` link if that has
+// the bonding or team driver, and its node is that of its device
+//
+// the nodes and the host only include the physical ports, and not any
+// bonds, VLANs, bridges and so on that carry the same traffic
+//
+class Rollup {
+
+public:
+	enum kind_t { BOND, NODE, HOST };
+
+	struct group_t {
+		kind_t			kind;
+		std::string		name;
+		std::vector<size_t>	members;	// indexes into the ifaces
+		Interface::ifstats_t	stats;
+		double			interval;	// the members' mean
+	};
+
+	//
+	// the display order - the NICs that aren't in a bond, then each
+	// bond followed by its members, and then the nodes and the host
+	//
+	struct entry_t {
+		long			group;		// or -1 for a NIC
+		size_t			nic;
+		bool			member;		// shown under its bond
+	};
+
+private:
+	const std::vector<std::shared_ptr<Interface>>&	ifaces;
+
+	std::vector<group_t>		_groups;
+	std::vector<entry_t>		_order;
+
+	void				map();
+
+public:
+	Rollup(const std::vector<std::shared_ptr<Interface>>& ifaces);
+
+	//
+	// add up the members' latest results - a member's counts are scaled
+	// to the group's interval, so that the group's rates are the sum of
+	// theirs, and a counter is only shown if all the members have it
+	//
+	void				refresh();
+
+	const std::vector<group_t>&	groups() const;
+	const std::vector<entry_t>&	order() const;
+};
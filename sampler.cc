@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <chrono>
+
+#include "sampler.h"
+
+Sampler::Sampler(const ifaces_t& ifaces, size_t nthreads)
+	: ifaces(ifaces), busy(new std::atomic<bool>[ifaces.size()])
+{
+	for (size_t i = 0; i < ifaces.size(); ++i) {
+		busy[i] = false;
+	}
+
+	for (size_t i = 0; i < nthreads; ++i) {
+		threads.emplace_back(&Sampler::worker, this);
+	}
+}
+
+Sampler::~Sampler()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+	}
+	start.notify_all();
+
+	for (auto& thread: threads) {
+		thread.join();
+	}
+}
+
+void Sampler::complete(uint32_t tick)
+{
+	auto r = remaining.load();
+	while (true) {
+		if ((r >> 32) != tick) {
+			return;
+		}
+		if (remaining.compare_exchange_weak(r, r - 1)) {
+			break;
+		}
+	}
+
+	if ((r & 0xffffffff) == 1) {
+		std::lock_guard<std::mutex> lock(mutex);
+		done.notify_one();
+	}
+}
+
+void Sampler::worker()
+{
+	uint32_t seen = 0;
+	uint64_t n = ifaces.size();
+
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			start.wait(lock, [&] { return stop || tick != seen; });
+			if (stop) return;
+			seen = tick;
+		}
+
+		// claim and refresh interfaces until there are none left
+		auto c = claim.load();
+		while ((c >> 32) == seen && (c & 0xffffffff) < n) {
+			if (!claim.compare_exchange_weak(c, c + 1)) {
+				continue;
+			}
+
+			auto i = c & 0xffffffff;
+			if (!busy[i].exchange(true, std::memory_order_acquire)) {
+				try {
+					ifaces[i]->refresh();
+				} catch (...) {
+					std::lock_guard<std::mutex> lock(mutex);
+					if (!error) {
+						error = std::current_exception();
+					}
+				}
+				busy[i].store(false, std::memory_order_release);
+			}
+
+			complete(seen);
+			c = claim.load();
+		}
+	}
+}
+
+void Sampler::refresh(uint64_t deadline)
+{
+	uint64_t n = ifaces.size();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		++tick;
+		remaining = (uint64_t(tick) << 32) | n;
+		claim = (uint64_t(tick) << 32);
+	}
+	start.notify_all();
+
+	// steady_clock is CLOCK_MONOTONIC
+	auto until = std::chrono::steady_clock::time_point(std::chrono::nanoseconds(deadline));
+
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait_until(lock, until, [&] {
+		return (remaining.load() & 0xffffffff) == 0;
+	});
+
+	// only reported once, so that the caller can carry on
+	if (error) {
+		auto e = error;
+		error = nullptr;
+		std::rethrow_exception(e);
+	}
+}
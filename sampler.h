@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+
+#include "interface.h"
+
+//
+// a pool of worker threads that refresh a set of interfaces
+// concurrently
+//
+// each tick the interfaces are claimed one at a time by whichever
+// worker is free, so one slow NIC only ever ties up one worker - if
+// a NIC is still busy with a previous tick's refresh it's skipped
+// and the display keeps its last published results until it's done
+//
+class Sampler {
+
+public:
+	typedef std::vector<std::shared_ptr<Interface>> ifaces_t;
+
+private:
+	const ifaces_t&				ifaces;
+	std::vector<std::thread>		threads;
+	std::unique_ptr<std::atomic<bool>[]>	busy;
+
+	//
+	// both of these hold the tick number in the top 32 bits so
+	// that workers still finishing an earlier tick can't claim
+	// or complete work in the current one
+	//
+	std::atomic<uint64_t>			claim { 0 };
+	std::atomic<uint64_t>			remaining { 0 };
+
+	uint32_t				tick = 0;
+	bool					stop = false;
+	std::exception_ptr			error;
+
+	std::mutex				mutex;
+	std::condition_variable			start;
+	std::condition_variable			done;
+
+	void					worker();
+	void					complete(uint32_t tick);
+
+public:
+	Sampler(const ifaces_t& ifaces, size_t nthreads);
+	~Sampler();
+
+	//
+	// refresh every interface, returning once they're all done
+	// or at `deadline` (ns, CLOCK_MONOTONIC) if that's sooner
+	//
+	void					refresh(uint64_t deadline);
+};
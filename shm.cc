@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "shm.h"
+#include "util.h"
+
+std::string shm_path(const std::string& name)
+{
+	return (!name.empty() && name[0] == '/') ? name : "/" + name;
+}
+
+ShmReader::ShmReader(const std::string& name)
+	: path(shm_path(name))
+{
+	fd = ::shm_open(path.c_str(), O_RDONLY | O_CLOEXEC, 0);
+	if (fd < 0) {
+		throw_errno("shm_open(" + path + ")");
+	}
+
+	try {
+		map();
+
+		auto h = reinterpret_cast<const shm_header_t*>(base);
+		if (mapped < sizeof *h || memcmp(h->magic, shm_magic, sizeof shm_magic) != 0) {
+			throw std::runtime_error(path + " isn't an ethq segment");
+		}
+
+		if (h->version != shm_version || h->header_size != sizeof(shm_header_t) ||
+		    h->nic_size != sizeof(shm_nic_t) || h->row_size != sizeof(shm_row_t))
+		{
+			throw std::runtime_error(path + " has an unsupported layout version");
+		}
+	} catch (...) {
+		if (base) ::munmap(const_cast<char*>(base), mapped);
+		::close(fd);
+		throw;
+	}
+}
+
+ShmReader::~ShmReader()
+{
+	::munmap(const_cast<char*>(base), mapped);
+	::close(fd);
+}
+
+// (re)map the whole of the segment as it now is
+void ShmReader::map()
+{
+	struct stat st;
+	if (::fstat(fd, &st) < 0) {
+		throw_errno("fstat(shm)");
+	}
+
+	if (base) {
+		::munmap(const_cast<char*>(base), mapped);
+		base = nullptr;
+	}
+
+	mapped = st.st_size;
+	auto p = ::mmap(nullptr, mapped, PROT_READ, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED) {
+		throw_errno("mmap(shm)");
+	}
+	base = static_cast<const char*>(p);
+}
+
+void ShmReader::read(snapshot_t& snap)
+{
+	for (unsigned tries = 0; ; ++tries) {
+		if (tries == 100000) {
+			throw std::runtime_error("couldn't get a consistent read of the shared memory segment");
+		}
+
+		auto h = reinterpret_cast<const shm_header_t*>(base);
+		auto seq = __atomic_load_n(&h->seq, __ATOMIC_ACQUIRE);
+		if (seq & 1) {
+			sched_yield();
+			continue;
+		}
+
+		memcpy(&snap.header, h, sizeof snap.header);
+
+		// a torn header is caught by the check of `seq` below
+		auto& header = snap.header;
+		auto nics_at = sizeof(shm_header_t);
+		auto rows_at = nics_at + header.nics * sizeof(shm_nic_t);
+		auto end = rows_at + header.rows * sizeof(shm_row_t);
+
+		if (end <= header.size && header.size <= mapped) {
+			snap.nics.resize(header.nics);
+			snap.rows.resize(header.rows);
+			memcpy(snap.nics.data(), base + nics_at, header.nics * sizeof(shm_nic_t));
+			memcpy(snap.rows.data(), base + rows_at, header.rows * sizeof(shm_row_t));
+		}
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&h->seq, __ATOMIC_RELAXED) != seq) {
+			continue;
+		}
+
+		// the segment has grown since it was mapped
+		if (header.size > mapped) {
+			map();
+			continue;
+		}
+
+		if (end <= header.size) {
+			return;
+		}
+	}
+}
+
+//
+// a publisher that stops without removing the segment, or is stopped
+// or hangs, is only noticed from its updates - those are allowed to
+// run a few intervals (and at least a couple of seconds) late
+//
+bool ShmReader::live(const snapshot_t& snap)
+{
+	auto& header = snap.header;
+	if (header.pid <= 0 || (::kill(header.pid, 0) < 0 && errno == ESRCH)) {
+		return false;
+	}
+
+	// the segment has been removed, and maybe replaced with another
+	struct stat st;
+	if (::fstat(fd, &st) < 0 || st.st_nlink == 0) {
+		return false;
+	}
+
+	auto grace = 3 * header.interval + UINT64_C(2000000000);
+	return clock_ns() < header.tick + grace;
+}
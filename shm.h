@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//
+// the POSIX shared memory segment through which one ethq publishes its
+// samples to any number of local readers (see ShmPublisher)
+//
+// the segment holds a header, then an entry for each NIC, and then the
+// rows of counters - each NIC's totals followed by its queues, as per
+// Interface::ifstats_t - all in native byte order
+//
+// the counters are running totals of the NICs' deltas, so a reader can
+// work out rates between any two of its reads, using each NIC's own
+// CLOCK_MONOTONIC timestamps
+//
+// the whole segment is protected by a sequence lock - the publisher
+// makes `seq` odd while it's writing and then even again, and a reader
+// copies everything out and tries again if `seq` was odd or changed -
+// so the publisher never waits for the readers and adds only a single
+// copy of the counters per tick however many readers there are
+//
+// the segment only ever grows, and the publisher bumps `layout` when
+// the set of NICs, their queues or the counters they supply change
+//
+// a segment belongs to the publisher whose pid is in the header for as
+// long as that process exists, and a reader can tell that it's stopped
+// publishing when `tick` falls behind its interval
+//
+static const char shm_magic[8] = { 'e', 't', 'h', 'q', '-', 's', 'h', 'm' };
+static const uint32_t shm_version = 2;
+
+struct shm_header_t {
+	char			magic[8];
+	uint32_t		version;
+	uint32_t		header_size;	// sizeof each of the three structs
+	uint32_t		nic_size;
+	uint32_t		row_size;
+	uint64_t		seq;		// odd while being written
+	uint64_t		size;		// bytes in use, including the header
+	uint64_t		tick;		// ns, CLOCK_MONOTONIC, of the latest update
+	uint32_t		layout;
+	uint32_t		nics;
+	uint32_t		rows;
+	int32_t			pid;		// of the publisher
+	uint64_t		interval;	// ns between updates
+};
+
+struct shm_nic_t {
+	char			name[16];	// NUL terminated
+	char			driver[32];
+	uint64_t		stamp;		// ns, CLOCK_MONOTONIC, of the latest sample
+	uint32_t		row;		// the NIC's totals, then its queues
+	uint32_t		queues;
+};
+
+struct shm_row_t {
+	uint64_t		counts[6];	// TX and RX packets, bytes and drops
+	uint32_t		present;	// bitmask of the counts supplied
+	uint32_t		reserved;
+};
+
+// "name" and "/name" name the same segment
+extern std::string shm_path(const std::string& name);
+
+//
+// takes consistent copies of a published segment - this depends only
+// on <shm.h> and shm.cc, so that other tools can use it
+//
+class ShmReader {
+
+public:
+	struct snapshot_t {
+		shm_header_t		header;
+		std::vector<shm_nic_t>	nics;
+		std::vector<shm_row_t>	rows;
+	};
+
+private:
+	int			fd = -1;
+	const char*		base = nullptr;
+	size_t			mapped = 0;
+
+	std::string		path;
+
+	void			map();
+
+public:
+	ShmReader(const std::string& name);
+	~ShmReader();
+
+	//
+	// copy out the latest update into `snap`, whose vectors are reused
+	// - if the publisher is mid-way through an update this retries
+	// until it's done, which takes at most a few microseconds
+	//
+	void			read(snapshot_t& snap);
+
+	//
+	// false if the publisher of `snap` has gone, or has been replaced,
+	// or hasn't updated the segment for a while
+	//
+	bool			live(const snapshot_t& snap);
+};
@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "shm_source.h"
+#include "netlink.h"
+#include "shm.h"
+
+//
+// the names of the counters in each row, as per Interface::ifstats_t,
+// for the NIC totals and (after the queue number) for each queue
+//
+static const char* total_names[] = {
+	"tx_packets", "rx_packets", "tx_bytes", "rx_bytes", "tx_dropped", "rx_dropped"
+};
+
+static const char* queue_names[][2] = {
+	{ "tx", "packets" }, { "rx", "packets" }, { "tx", "bytes" },
+	{ "rx", "bytes" }, { "tx", "drops" }, { "rx", "drops" }
+};
+
+static const size_t ncounts = sizeof(total_names) / sizeof(total_names[0]);
+
+namespace {
+
+struct entry_t {
+	long			nic = -1;	// in the snapshot, if it's there
+	bool			located = false;
+	bool			seen = false;
+
+	// the counters supplied in each row, and when they last changed
+	std::vector<uint32_t>	shape;
+	unsigned		generation = 0;
+
+	// the latest values of those counters, and when they were sampled
+	std::vector<__u64>	values;
+	uint64_t		stamp = 0;
+	std::string		driver;
+};
+
+}
+
+class ShmSource::Batch : public SharedDump<std::string, entry_t> {
+
+private:
+	std::string		path;
+	ShmReader		reader;
+	ShmReader::snapshot_t	snap;
+	uint32_t		layout = 0;
+
+	void			locate(const std::string& name, entry_t& entry);
+	void			dump();
+
+public:
+	Batch(const std::string& segment);
+};
+
+ShmSource::Batch::Batch(const std::string& segment)
+	: path(shm_path(segment)), reader(segment)
+{
+}
+
+// find a NIC's entry in the snapshot, and notice any change in its counters
+void ShmSource::Batch::locate(const std::string& name, entry_t& entry)
+{
+	entry.nic = -1;
+	entry.located = true;
+	std::vector<uint32_t> shape;
+
+	for (size_t i = 0; i < snap.nics.size(); ++i) {
+		auto& nic = snap.nics[i];
+		if (strncmp(nic.name, name.c_str(), sizeof nic.name) != 0) continue;
+		if (nic.row + nic.queues + 1 > snap.rows.size()) break;
+
+		entry.nic = i;
+		entry.seen = true;
+		entry.driver.assign(nic.driver, strnlen(nic.driver, sizeof nic.driver));
+		for (size_t row = 0; row <= nic.queues; ++row) {
+			shape.push_back(snap.rows[nic.row + row].present);
+		}
+		break;
+	}
+
+	if (shape != entry.shape) {
+		entry.shape.swap(shape);
+		++entry.generation;
+	}
+}
+
+//
+// one copy of the segment, from which each NIC's counters are picked
+// out - a NIC that's no longer published just stops changing
+//
+void ShmSource::Batch::dump()
+{
+	reader.read(snap);
+
+	// there's nothing more to show once the publisher has stopped
+	if (!reader.live(snap)) {
+		throw std::runtime_error("the publisher of " + path + " has stopped");
+	}
+
+	// a census takes every NIC in the segment
+	if (census) {
+		for (const auto& nic: snap.nics) {
+			slot(std::string(nic.name, strnlen(nic.name, sizeof nic.name)));
+		}
+	}
+
+	// the NICs only move when the publisher changes the layout
+	bool moved = (snap.header.layout != layout);
+	layout = snap.header.layout;
+
+	for (auto& iter: entries) {
+		auto& entry = iter.second;
+		if (moved || !entry.located) {
+			locate(iter.first, entry);
+		}
+		if (entry.nic < 0) continue;
+
+		size_t n = 0;
+		for (auto present: entry.shape) {
+			n += __builtin_popcount(present);
+		}
+		entry.values.resize(n);
+
+		auto& nic = snap.nics[entry.nic];
+		auto p = entry.values.data();
+		for (size_t row = 0; row < entry.shape.size(); ++row) {
+			auto& counts = snap.rows[nic.row + row].counts;
+			for (size_t k = 0; k < ncounts; ++k) {
+				if (entry.shape[row] & (1U << k)) {
+					*p++ = counts[k];
+				}
+			}
+		}
+		entry.stamp = nic.stamp;
+	}
+}
+
+std::vector<std::string> ShmSource::list(const std::string& segment)
+{
+	ShmReader reader(segment);
+	ShmReader::snapshot_t snap;
+	reader.read(snap);
+
+	std::vector<std::string> result;
+	for (const auto& nic: snap.nics) {
+		result.emplace_back(nic.name, strnlen(nic.name, sizeof nic.name));
+	}
+	return result;
+}
+
+// NB: only the first segment named is ever read
+ShmSource::ShmSource(const std::string& segment, const std::string& ifname)
+	: _name(ifname)
+{
+	batch = shared_dump<Batch>(segment);
+	batch->add(ifname);
+	if (!batch->supported(ifname)) {
+		batch->remove(ifname);
+		throw std::runtime_error(ifname + " isn't published in " + shm_path(segment));
+	}
+
+	batch->with(ifname, [&](entry_t& entry) {
+		_driver = entry.driver;
+	});
+}
+
+ShmSource::~ShmSource()
+{
+	batch->remove(_name);
+}
+
+ShmSource::stringset_t ShmSource::stringset(ethtool_stringset ss)
+{
+	stringset_t result;
+	if (ss != ETH_SS_STATS) {
+		return result;
+	}
+
+	batch->with(_name, [&](entry_t& entry) {
+		for (size_t row = 0; row < entry.shape.size(); ++row) {
+			auto queue = row ? "_queue_" + std::to_string(row - 1) + "_" : std::string();
+			for (size_t k = 0; k < ncounts; ++k) {
+				if (!(entry.shape[row] & (1U << k))) continue;
+				if (row) {
+					result.push_back(queue_names[k][0] + queue + queue_names[k][1]);
+				} else {
+					result.push_back(total_names[k]);
+				}
+			}
+		}
+	});
+	return result;
+}
+
+void ShmSource::stats(snapshot_t& snap)
+{
+	batch->get(_name, [&](entry_t& entry) {
+		if (entry.nic < 0) return;
+		snap.resize(entry.values.size());
+		std::copy(entry.values.begin(), entry.values.end(), snap.data());
+		_generation = entry.generation;
+		_stamp = entry.stamp;
+	});
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "source.h"
+
+//
+// reads a NIC's counters from the shared memory segment of another
+// ethq that's publishing them (see ShmPublisher), instead of from the
+// NIC itself
+//
+// all instances share a single reader, and one consistent copy of the
+// segment per tick supplies every NIC - the first NIC to ask for its
+// stats in a tick triggers the copy, and the others consume it
+//
+// the stats strings are synthesized in the generic driver's format
+// from the counters that the publisher supplies (e.g. "tx_bytes" and
+// "rx_queue_3_packets"), and the generation changes if those do - the
+// timestamps are the publisher's, so a NIC that hasn't been sampled
+// again since the previous read is seen as unchanged
+//
+class ShmSource : public StatsSource {
+
+public:
+	class Batch;
+
+private:
+	Batch*			batch;
+
+	std::string		_name;
+	std::string		_driver;
+	unsigned		_generation = 0;
+	uint64_t		_stamp = 0;
+
+public:
+				ShmSource(const std::string& segment, const std::string& ifname);
+				~ShmSource();
+
+	// the names of the NICs in the segment, in the order they're published
+	static std::vector<std::string>	list(const std::string& segment);
+
+public:
+	stringset_t		stringset(ethtool_stringset);
+	void			stats(snapshot_t& snap);
+	unsigned		generation()	{ return _generation; };
+	uint64_t		stamp()		{ return _stamp; };
+
+	std::string		driver()	{ return _driver; };
+	std::string		version()	{ return ""; };
+	std::string		parser()	{ return "shm"; };
+};
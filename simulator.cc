@@ -0,0 +1,382 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "simulator.h"
+#include "matcher.h"
+#include "parser.h"
+#include "util.h"
+
+class Simulator::Model {
+
+public:
+	enum kind_t : uint8_t { FIXED, TOTAL, QUEUE };
+
+	struct entry_t {
+		kind_t		kind;
+		uint8_t		offset;		// as per Interface::ifstats_t
+		uint32_t	queue;
+		uint64_t	value;		// FIXED only
+		double		scale;		// multiple of a unit queue's rate
+	};
+
+	config_t		config;
+	stringset_t		names;
+	std::vector<entry_t>	entries;
+
+	// simulated NICs have been up for a while
+	uint64_t		origin = clock_ns() - UINT64_C(3600000000000);
+
+	// packets sent by a queue of unit weight after `t` seconds
+	double packets(double t) const {
+		auto& c = config;
+		if (c.burst_period <= 0) {
+			return c.rate * t;
+		}
+
+		// time spent in bursts so far
+		auto on = c.burst_period * c.burst_duty;
+		auto periods = std::floor(t / c.burst_period);
+		auto bursts = periods * on + std::min(t - periods * c.burst_period, on);
+
+		return c.rate * (t + (c.burst_factor - 1) * bursts);
+	}
+};
+
+static size_t number(const std::string& key, const std::string& value)
+{
+	char *end;
+	auto n = strtoul(value.c_str(), &end, 10);
+	if (value.empty() || *end) {
+		throw std::runtime_error("bad simulator " + key + ": " + value);
+	}
+	return n;
+}
+
+static double real(const std::string& key, const std::string& value)
+{
+	char *end;
+	auto n = strtod(value.c_str(), &end);
+	if (value.empty() || *end || !(n >= 0)) {
+		throw std::runtime_error("bad simulator " + key + ": " + value);
+	}
+	return n;
+}
+
+Simulator::config_t Simulator::config_t::parse(const std::string& spec)
+{
+	config_t config;
+
+	std::istringstream in(spec);
+	std::string item;
+
+	std::getline(in, config.driver, ',');
+	if (config.driver.empty()) {
+		throw std::runtime_error("missing simulator driver");
+	}
+
+	while (std::getline(in, item, ',')) {
+		auto eq = item.find('=');
+		auto key = item.substr(0, eq);
+		auto value = (eq == std::string::npos) ? "" : item.substr(eq + 1);
+
+		if (key == "file") {
+			config.file = value;
+		} else if (key == "count") {
+			config.count = number(key, value);
+		} else if (key == "queues") {
+			config.queues = number(key, value);
+		} else if (key == "rate") {
+			config.rate = real(key, value);
+		} else if (key == "size") {
+			config.size = real(key, value);
+		} else if (key == "skew") {
+			config.skew = std::min(real(key, value), 1.0);
+		} else if (key == "loss") {
+			config.loss = std::min(real(key, value), 1.0);
+		} else if (key == "delay") {
+			config.delay = number(key, value) * 1000;
+		} else if (key == "burst") {
+			std::istringstream parts(value);
+			std::string part;
+			double* fields[] = { &config.burst_period, &config.burst_duty, &config.burst_factor };
+			for (auto field: fields) {
+				if (!std::getline(parts, part, '/')) break;
+				*field = real(key, part);
+			}
+			if (config.burst_duty <= 0 || config.burst_duty > 1) {
+				throw std::runtime_error("bad simulator burst duty cycle: " + value);
+			}
+		} else {
+			throw std::runtime_error("unknown simulator option: " + item);
+		}
+	}
+
+	if (config.count == 0) {
+		throw std::runtime_error("bad simulator count: 0");
+	}
+
+	if (config.file.empty()) {
+		config.file = "tests/" + config.driver;
+	}
+
+	return config;
+}
+
+//
+// NB: the parsers aren't thread safe, so this mustn't be called
+// while interfaces are being constructed
+//
+std::shared_ptr<const Simulator::Model> Simulator::build(const config_t& config)
+{
+	auto parser = StringsetParser::find(config.driver);
+	if (!parser) {
+		throw std::runtime_error("Unsupported NIC driver " + config.driver);
+	}
+
+	std::ifstream file(config.file);
+	if (!file) {
+		throw std::runtime_error("can't read " + config.file);
+	}
+
+	//
+	// classify a stat, exactly as StatsMap would
+	//
+	auto classify = [&](const std::string& name, uint64_t value, Model::entry_t& entry) {
+		bool rx = false, bytes = false;
+		size_t queue = 0;
+
+		if (parser->match_total(name, value, rx, bytes)) {
+			entry.kind = Model::TOTAL;
+			entry.offset = rx + 2 * bytes;
+		}
+
+		if (parser->match_queue(name, value, rx, bytes, queue)) {
+			entry.kind = Model::QUEUE;
+			entry.offset = rx + 2 * bytes;
+			entry.queue = queue;
+		}
+
+		if (entry.kind != Model::FIXED) return;
+
+		if (parser->match_drop_total(name, value, rx)) {
+			entry.kind = Model::TOTAL;
+			entry.offset = 4 + rx;
+		}
+
+		if (parser->match_drop_queue(name, value, rx, queue)) {
+			entry.kind = Model::QUEUE;
+			entry.offset = 4 + rx;
+			entry.queue = queue;
+		}
+	};
+
+	struct stat_t {
+		std::string		name;
+		Model::entry_t		entry;
+	};
+
+	std::vector<stat_t> stats;
+	size_t file_queues = 0;
+
+	Matcher re("^\\s*(.*?): (\\d+)$");
+	Matcher::captures_t caps;
+	std::string line;
+
+	while (std::getline(file, line)) {
+		if (!re.match(line, caps)) continue;
+
+		auto name = caps[1].str();
+		auto value = std::stoull(caps[2].str());
+
+		Model::entry_t entry = { Model::FIXED, 0, 0, value, 0 };
+		classify(name, value, entry);
+
+		if (entry.kind == Model::QUEUE) {
+			file_queues = std::max<size_t>(file_queues, entry.queue + 1);
+		}
+
+		stats.push_back({ name, entry });
+	}
+
+	auto model = std::make_shared<Model>();
+	model->config = config;
+
+	auto queues = config.queues ? config.queues : file_queues;
+	if (queues != file_queues) {
+
+		if (parser->value_dependent()) {
+			throw std::runtime_error("can't change the number of queues for " + config.driver);
+		}
+
+		//
+		// find where the queue number appears in each of queue 0's
+		// stats - it's the run of digits which, when changed to 1,
+		// gives the same stat for queue 1
+		//
+		std::vector<std::pair<std::string, std::string>> templates;
+		std::vector<Model::entry_t> tentries;
+
+		for (const auto& stat: stats) {
+			auto& entry = stat.entry;
+			if (entry.kind != Model::QUEUE || entry.queue != 0) continue;
+
+			auto& name = stat.name;
+			bool found = false;
+
+			for (size_t i = 0; !found && i < name.size(); ++i) {
+				if (name[i] != '0' || (i > 0 && isdigit(name[i - 1])) ||
+				    (i + 1 < name.size() && isdigit(name[i + 1])))
+				{
+					continue;
+				}
+
+				auto prefix = name.substr(0, i);
+				auto suffix = name.substr(i + 1);
+
+				Model::entry_t other = { Model::FIXED, 0, 0, 0, 0 };
+				classify(prefix + "1" + suffix, 0, other);
+				if (other.kind == Model::QUEUE && other.queue == 1 && other.offset == entry.offset) {
+					templates.emplace_back(prefix, suffix);
+					tentries.push_back(entry);
+					found = true;
+				}
+			}
+
+			if (!found) {
+				throw std::runtime_error("can't change the number of queues for " + config.driver);
+			}
+		}
+
+		//
+		// replace the file's queue stats with those for the required
+		// number of queues, all at the position of the first of them
+		//
+		bool placed = false;
+		for (const auto& stat: stats) {
+			if (stat.entry.kind != Model::QUEUE) {
+				model->names.push_back(stat.name);
+				model->entries.push_back(stat.entry);
+			} else if (!placed) {
+				for (size_t q = 0; q < queues; ++q) {
+					for (size_t t = 0; t < templates.size(); ++t) {
+						model->names.push_back(templates[t].first + std::to_string(q) + templates[t].second);
+						model->entries.push_back(tentries[t]);
+						model->entries.back().queue = q;
+					}
+				}
+				placed = true;
+			}
+		}
+	} else {
+		for (const auto& stat: stats) {
+			model->names.push_back(stat.name);
+			model->entries.push_back(stat.entry);
+		}
+	}
+
+	//
+	// spread the queue rates evenly over 1 +/- skew - a NIC without
+	// per-queue stats is treated as having a single queue
+	//
+	std::vector<double> weights;
+	double total_weight = 0;
+
+	for (size_t q = 0; q < std::max(queues, size_t(1)); ++q) {
+		double frac = std::fmod(q * 0.6180339887, 1.0);
+		weights.push_back(1 + config.skew * (2 * frac - 1));
+		total_weight += weights.back();
+	}
+
+	//
+	// where a driver splits a value over several stats (e.g. unicast,
+	// multicast and broadcast packets) it's shared equally between them,
+	// so that the totals still add up
+	//
+	size_t splits[3][6] = { };
+	for (auto& entry: model->entries) {
+		if (entry.kind != Model::QUEUE || entry.queue == 0) {
+			splits[entry.kind][entry.offset]++;
+		}
+	}
+
+	for (auto& entry: model->entries) {
+		auto n = splits[entry.kind][entry.offset];
+		if (entry.kind == Model::TOTAL) {
+			entry.scale = total_weight / n;
+		} else if (entry.kind == Model::QUEUE) {
+			entry.scale = weights[entry.queue] / n;
+		}
+	}
+
+	return model;
+}
+
+Simulator::Simulator(const std::shared_ptr<const Model>& model, size_t index)
+	: model(model)
+{
+	// so that the NICs' bursts don't all coincide
+	phase = std::fmod(index * 0.6180339887, 1.0) * model->config.burst_period;
+}
+
+StatsSource::stringset_t Simulator::stringset(ethtool_stringset ss)
+{
+	if (ss == ETH_SS_STATS) {
+		return model->names;
+	}
+	return stringset_t();
+}
+
+void Simulator::stats(snapshot_t& snap)
+{
+	auto& m = *model;
+	auto n = m.entries.size();
+	snap.resize(n);
+
+	auto t = (clock_ns() - m.origin) / 1e9 + phase;
+	double values[6];
+	values[0] = values[1] = m.packets(t);
+	values[2] = values[3] = values[0] * m.config.size;
+	values[4] = values[5] = values[0] * m.config.loss;
+
+	auto p = snap.data();
+	auto e = m.entries.data();
+	for (size_t i = 0; i < n; ++i) {
+		switch (e[i].kind) {
+			case Model::FIXED:
+				p[i] = e[i].value;
+				break;
+			case Model::TOTAL:
+			case Model::QUEUE:
+				p[i] = values[e[i].offset] * e[i].scale;
+				break;
+		}
+	}
+
+	if (m.config.delay) {
+		timespec ts = { static_cast<time_t>(m.config.delay / 1000000000), static_cast<long>(m.config.delay % 1000000000) };
+		while (nanosleep(&ts, &ts) < 0 && errno == EINTR);
+	}
+}
+
+std::string Simulator::driver()
+{
+	return model->config.driver;
+}
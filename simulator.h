@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "source.h"
+
+//
+// a synthetic NIC, which presents a real driver's stats strings (as
+// captured in one of the files in tests/) but generates the counter
+// values itself, so that ethq can be run at scale without the NICs
+//
+// the per-queue packet and byte counters increase at a configurable
+// rate, optionally spread unevenly over the queues and with periodic
+// bursts, the drop counters at a fraction of that, and the NIC totals
+// are the sum of the queues - any other counters keep the values from
+// the file
+//
+// where the driver's parser allows, the number of queues can differ
+// from that in the file, with the names of the extra queues' counters
+// generated from those of queue 0
+//
+class Simulator : public StatsSource {
+
+public:
+	struct config_t {
+		std::string	driver;
+		std::string	file;			// default tests/<driver>
+		size_t		count = 1;		// number of NICs
+		size_t		queues = 0;		// 0: as in the file
+		double		rate = 1000;		// packets/s per queue
+		double		size = 1000;		// bytes per packet
+		double		skew = 0;		// spread of queue rates, 0 - 1
+		double		burst_period = 0;	// seconds, 0: no bursts
+		double		burst_duty = 0.1;	// fraction of each period
+		double		burst_factor = 10;	// rate multiplier in a burst
+		double		loss = 0;		// fraction of packets dropped
+		uint64_t	delay = 0;		// extra ns per stats read
+
+		//
+		// parses `driver[,key=value,...]`, with the keys being
+		// file, count, queues, rate, size, skew, loss, delay (in us)
+		// and burst=period/duty/factor
+		//
+		static config_t	parse(const std::string& spec);
+	};
+
+	//
+	// the string set and counter layout, shared by every simulated
+	// NIC with the same configuration
+	//
+	class Model;
+
+private:
+	std::shared_ptr<const Model>	model;
+	double				phase;		// seconds
+
+public:
+	Simulator(const std::shared_ptr<const Model>& model, size_t index);
+
+	static std::shared_ptr<const Model> build(const config_t& config);
+
+public:
+	stringset_t		stringset(ethtool_stringset ss);
+	void			stats(snapshot_t& snap);
+
+	std::string		driver();
+	std::string		version()	{ return "sim"; };
+};
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include <linux/types.h>
+#include <linux/ethtool.h>
+
+//
+// abstract base class for anything that can supply a NIC's list
+// of named counters and then periodically read their values
+//
+class StatsSource {
+
+public:
+	typedef std::vector<std::string> stringset_t;
+
+	//
+	// a caller-owned buffer of raw counter values, with room for an
+	// ethtool_stats header immediately in front of the values so that
+	// the kernel can fill it in place
+	//
+	// resizing is a no-op once the buffer is the right size, so a
+	// snapshot that's reused every tick never reallocates
+	//
+	class snapshot_t {
+
+	private:
+		std::vector<__u64>	buf = std::vector<__u64>(1);
+
+	public:
+		void resize(size_t n) {
+			if (n != size()) {
+				buf.assign(n + 1, 0);
+			}
+		}
+
+		size_t size() const		{ return buf.size() - 1; };
+		__u64* data()			{ return buf.data() + 1; };
+		const __u64* data() const	{ return buf.data() + 1; };
+		__u64 operator[](size_t n) const { return buf[n + 1]; };
+
+		ethtool_stats* header() {
+			static_assert(sizeof(ethtool_stats) == sizeof(__u64), "unexpected ethtool_stats size");
+			return reinterpret_cast<ethtool_stats*>(buf.data());
+		}
+	};
+
+public:
+	virtual ~StatsSource() = default;
+
+	virtual stringset_t		stringset(ethtool_stringset ss) = 0;
+
+	//
+	// read the current counter values into `snap`, resizing it if
+	// the number of counters has changed
+	//
+	virtual void			stats(snapshot_t& snap) = 0;
+
+	//
+	// changes whenever stats() notices that the string set may have
+	// changed other than in size (e.g. the driver was replaced)
+	//
+	virtual unsigned		generation()	{ return 0; };
+
+	//
+	// when the values that stats() returned were sampled (ns,
+	// CLOCK_MONOTONIC), for sources that pass on someone else's
+	// samples, or 0 if they were read just now
+	//
+	virtual uint64_t		stamp()		{ return 0; };
+
+	virtual std::string		driver() = 0;
+	virtual std::string		version() = 0;
+
+	// the name under which the StringsetParser for this source's
+	// stats strings is registered
+	virtual std::string		parser()	{ return driver(); };
+};
@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+#include <unistd.h>
+
+#include "statsmap.h"
+
+static const char* magic = "ethq-statsmap 2";
+
+//
+// guards the in-memory map table, and also serialises the use
+// of stateful parsers whose results depend on the stats values
+//
+static std::mutex mutex;
+static std::map<std::string, StatsMap::ptr_t> maps;
+
+std::string StatsMap::cache_dir;
+
+static uint64_t fnv1a(const std::string& s, uint64_t hash = 0xcbf29ce484222325ULL)
+{
+	for (auto c: s) {
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static std::string hex(uint64_t n)
+{
+	char buf[17];
+	snprintf(buf, sizeof buf, "%016llx", static_cast<unsigned long long>(n));
+	return buf;
+}
+
+// as per Interface::ifstats_t
+static size_t get_offset(bool rx, bool bytes)
+{
+	return rx + 2 * bytes;
+}
+
+static size_t get_drop_offset(bool rx)
+{
+	return 4 + rx;
+}
+
+void StatsMap::set_cache_dir(const std::string& dir)
+{
+	cache_dir = dir;
+}
+
+StatsMap::ptr_t StatsMap::build(StringsetParser* parser,
+				const StatsSource::stringset_t& names,
+				const StatsSource::snapshot_t& state)
+{
+	auto entries = std::make_shared<entries_t>();
+
+	//
+	// iterate through all of the stats looking for names that
+	// match the recognised strings
+	//
+	for (size_t i = 0, n = names.size(); i < n; ++i) {
+
+		size_t queue = -1;
+		auto rx = false;
+		auto bytes = false;
+
+		entry_t entry = { static_cast<uint32_t>(i), -1, -1, 0 };
+
+		//
+		// try to map the stringset entry to a NIC total
+		//
+		if (parser->match_total(names[i], state[i], rx, bytes)) {
+			entry.total = get_offset(rx, bytes);
+		}
+
+		//
+		// try to map the stringset entry to a queue - pass the initially
+		// read value too, for those drivers (e.g. vmxnet3) that store the
+		// queue number in a key-value pair
+		//
+		if (parser->match_queue(names[i], state[i], rx, bytes, queue)) {
+			entry.queue = queue;
+			entry.offset = get_offset(rx, bytes);
+		}
+
+		//
+		// or failing those, to a drop counter
+		//
+		if (entry.total < 0 && entry.queue < 0) {
+			if (parser->match_drop_total(names[i], state[i], rx)) {
+				entry.total = get_drop_offset(rx);
+			}
+
+			if (parser->match_drop_queue(names[i], state[i], rx, queue)) {
+				entry.queue = queue;
+				entry.offset = get_drop_offset(rx);
+			}
+		}
+
+		if (entry.total >= 0 || entry.queue >= 0) {
+			entries->push_back(entry);
+		}
+	}
+
+	return entries;
+}
+
+StatsMap::ptr_t StatsMap::load(const std::string& path, const std::string& key)
+{
+	std::ifstream in(path);
+	if (!in) {
+		return nullptr;
+	}
+
+	std::string line;
+	if (!std::getline(in, line) || line != magic) return nullptr;
+	if (!std::getline(in, line) || line != key) return nullptr;
+
+	size_t count;
+	if (!(in >> count)) return nullptr;
+
+	auto entries = std::make_shared<entries_t>();
+	entries->reserve(count);
+
+	entry_t entry;
+	while (entries->size() < count && in >> entry.index >> entry.total >> entry.queue >> entry.offset) {
+		entries->push_back(entry);
+	}
+
+	if (entries->size() != count) {
+		return nullptr;
+	}
+
+	return entries;
+}
+
+void StatsMap::save(const std::string& path, const std::string& key, const entries_t& entries)
+{
+	std::ostringstream out;
+	out << magic << "\n" << key << "\n" << entries.size() << "\n";
+	for (const auto& entry: entries) {
+		out << entry.index << " " << entry.total << " "
+		    << entry.queue << " " << entry.offset << "\n";
+	}
+
+	// write-then-rename so that readers never see a partial file
+	auto tmp = path + "." + std::to_string(getpid()) + ".tmp";
+	std::ofstream file(tmp);
+	file << out.str();
+	file.close();
+
+	if (!file || rename(tmp.c_str(), path.c_str()) < 0) {
+		unlink(tmp.c_str());		// the cache is only advisory
+	}
+}
+
+StatsMap::ptr_t StatsMap::get(StringsetParser* parser,
+			      const std::string& parser_name,
+			      const std::string& driver,
+			      const std::string& version,
+			      const StatsSource::stringset_t& names,
+			      const StatsSource::snapshot_t& state)
+{
+	// can't be shared if the map depends on the NIC's values
+	if (parser->value_dependent()) {
+		std::lock_guard<std::mutex> lock(mutex);
+		return build(parser, names, state);
+	}
+
+	uint64_t hash = fnv1a("");
+	for (const auto& name: names) {
+		hash = fnv1a(name + "\n", hash);
+	}
+
+	// the parser's fingerprint, so that a changed parser isn't given a stale map
+	auto key = parser_name + "/" + hex(fnv1a(parser->fingerprint())) + "/"
+		 + driver + "/" + version + "/"
+		 + std::to_string(names.size()) + "/" + hex(hash);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto iter = maps.find(key);
+		if (iter != maps.end()) {
+			return iter->second;
+		}
+	}
+
+	ptr_t result;
+	std::string path;
+
+	if (!cache_dir.empty()) {
+		path = cache_dir + "/" + hex(fnv1a(key)) + ".map";
+		result = load(path, key);
+	}
+
+	if (!result) {
+		result = build(parser, names, state);
+		if (!path.empty()) {
+			save(path, key, *result);
+		}
+	}
+
+	// another thread may have got there first
+	std::lock_guard<std::mutex> lock(mutex);
+	return maps.emplace(key, result).first->second;
+}
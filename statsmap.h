@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "source.h"
+#include "parser.h"
+
+//
+// the result of matching each of a NIC's stats strings with its
+// parser
+//
+// for most drivers that depends only on the driver and the strings
+// themselves, so the map is built once and then shared by every NIC
+// with the same driver, version and string set (e.g. SR-IOV VFs) -
+// it may also be cached on disk, keyed the same way, so that later
+// runs needn't parse the strings at all
+//
+class StatsMap {
+
+public:
+	struct entry_t {
+		uint32_t		index;		// into the stats table
+		int32_t			total;		// offset of total value, or -1
+		int32_t			queue;		// queue number, or -1
+		int32_t			offset;		// offset of queue value
+	};
+
+	typedef std::vector<entry_t> entries_t;
+	typedef std::shared_ptr<const entries_t> ptr_t;
+
+private:
+	static std::string		cache_dir;
+
+	static ptr_t			build(StringsetParser* parser,
+					      const StatsSource::stringset_t& names,
+					      const StatsSource::snapshot_t& state);
+	static ptr_t			load(const std::string& path, const std::string& key);
+	static void			save(const std::string& path, const std::string& key, const entries_t& entries);
+
+public:
+	static ptr_t			get(StringsetParser* parser,
+					    const std::string& parser_name,
+					    const std::string& driver,
+					    const std::string& version,
+					    const StatsSource::stringset_t& names,
+					    const StatsSource::snapshot_t& state);
+
+	// enable the on-disk cache
+	static void			set_cache_dir(const std::string& dir);
+};
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "summary.h"
+#include "format.h"
+
+static const size_t ncols = 8;
+static const size_t widths[ncols] = { 6, 8, 10, 10, 10, 10, 10, 10 };
+
+static const double points[] = { 0.5, 0.99, 0.999 };
+
+// the byte counters, which are shown as bit rates
+static bool is_bits(size_t k)
+{
+	return k == 2 || k == 3;
+}
+
+void Summary::update(const ifaces_t& ifaces)
+{
+	rows.resize(ifaces.size());
+	stamps.resize(ifaces.size());
+
+	for (size_t i = 0; i < ifaces.size(); ++i) {
+		auto& iface = ifaces[i];
+		auto stamp = iface->timestamp();
+		auto elapsed = iface->interval_ns();
+
+		// only new samples, and not the initial one
+		if (stamp == stamps[i] || elapsed == 0) {
+			continue;
+		}
+		stamps[i] = stamp;
+
+		auto& hists = rows[i];
+		auto n = iface->queue_count() + 1;
+		if (hists.size() < n) {
+			hists.resize(n);
+		}
+
+		for (size_t row = 0; row < n; ++row) {
+			auto& stats = row ? iface->queue_stats(row - 1) : iface->total_stats();
+			for (size_t k = 0; k < 6; ++k) {
+				if (!stats.has(k)) continue;
+				auto rate = stats.counts[k] * 1e9 / elapsed;
+				hists[row][k].add(static_cast<uint64_t>((is_bits(k) ? rate * 8 : rate) + 0.5));
+			}
+		}
+	}
+}
+
+//
+// one table per NIC, with a line for each counter of the totals and
+// of each queue - bit rates are shown in Mbps unless `si` is set
+//
+void Summary::write(std::ostream& out, const ifaces_t& ifaces, bool si) const
+{
+	static const char* hdrs[ncols] = { "queue", "", "min", "mean", "p50", "p99", "p99.9", "max" };
+	static const char* metrics[2][6] = {
+		{ "TX pps", "RX pps", "TX Mbps", "RX Mbps", "TX drops", "RX drops" },
+		{ "TX pps", "RX pps", "TX bps", "RX bps", "TX drops", "RX drops" }
+	};
+
+	char line[out_max];
+	char num[fmt_max];
+
+	auto value = [&](double v, size_t k) {
+		if (si) {
+			return fmt_si(num, v);
+		} else if (!is_bits(k)) {
+			return fmt_u64(num, static_cast<uint64_t>(v + 0.5));
+		} else {
+			return fmt_fixed(num, v / 1e6, 3);
+		}
+	};
+
+	for (size_t i = 0; i < ifaces.size() && i < rows.size(); ++i) {
+		auto& hists = rows[i];
+		uint64_t samples = 0;
+		for (auto& row: hists) {
+			for (auto& h: row) {
+				samples = std::max(samples, h.count());
+			}
+		}
+
+		out << ifaces[i]->name() << ": " << samples << " samples" << std::endl;
+
+		auto p = line;
+		for (size_t c = 0; c < ncols; ++c) {
+			if (c) *p++ = ' ';
+			p = fmt_right(p, widths[c], hdrs[c], strlen(hdrs[c]));
+		}
+		*p++ = '\n';
+		out.write(line, p - line);
+
+		for (size_t row = 0; row < hists.size(); ++row) {
+			for (size_t k = 0; k < 6; ++k) {
+				auto& h = hists[row][k];
+				if (h.count() == 0) continue;
+
+				char label[fmt_max];
+				auto len = row ? fmt_u64(label, row - 1) - label : 5;
+				if (!row) memcpy(label, "total", len);
+
+				p = fmt_right(line, widths[0], label, len);
+				*p++ = ' ';
+				p = fmt_right(p, widths[1], metrics[si][k], strlen(metrics[si][k]));
+
+				double stats[ncols - 2] = {
+					double(h.min()), h.mean(),
+					double(h.percentile(points[0])),
+					double(h.percentile(points[1])),
+					double(h.percentile(points[2])),
+					double(h.max())
+				};
+
+				for (size_t c = 2; c < ncols; ++c) {
+					*p++ = ' ';
+					p = fmt_right(p, widths[c], num, value(stats[c - 2], k) - num);
+				}
+				*p++ = '\n';
+				out.write(line, p - line);
+			}
+		}
+
+		out << std::endl;
+	}
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "histogram.h"
+#include "render.h"
+
+//
+// the distributions of each NIC's and each queue's packet, bit and
+// drop rates over a run, for the end-of-run report
+//
+// each new sample's rates are added to a histogram per counter, so
+// the memory used doesn't depend on the length of the run
+//
+class Summary {
+
+private:
+	// TX and RX packets/s, then TX and RX bits/s, then TX and RX drops/s
+	typedef std::array<Histogram, 6>	row_t;
+
+	std::vector<std::vector<row_t>>	rows;
+	std::vector<uint64_t>		stamps;
+
+public:
+	void				update(const ifaces_t& ifaces);
+	void				write(std::ostream& out, const ifaces_t& ifaces, bool si = false) const;
+};
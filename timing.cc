@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "timing.h"
+#include "format.h"
+
+static const size_t ncols = 7;
+static const size_t widths[ncols] = { 32, 8, 9, 9, 9, 9, 9 };
+
+void SelfTiming::update(const ifaces_t& ifaces)
+{
+	if (nics.size() < ifaces.size()) {
+		nics.resize(ifaces.size());
+	}
+
+	for (size_t i = 0; i < ifaces.size(); ++i) {
+		auto& iface = ifaces[i];
+		auto& nic = nics[i];
+
+		// a slot is only ever reused by a NIC with the same name
+		if (nic.name.empty()) {
+			nic.name = iface->name();
+			nic.driver = iface->driver();
+		}
+
+		auto stamp = iface->timestamp();
+		if (iface->detached() || stamp == nic.stamp || iface->interval_ns() == 0) {
+			nic.last_read = 0;
+			continue;
+		}
+
+		nic.stamp = stamp;
+		nic.last_read = iface->read_ns();
+		nic.read.add(iface->read_ns());
+		nic.refresh.add(iface->refresh_ns());
+	}
+}
+
+size_t SelfTiming::format_status(char* line, size_t size) const
+{
+	const nic_t* slowest = nullptr;
+	for (auto& nic: nics) {
+		if (nic.last_read && (!slowest || nic.last_read > slowest->last_read)) {
+			slowest = &nic;
+		}
+	}
+
+	auto ms = [](uint64_t ns) { return ns / 1e6; };
+
+	auto len = snprintf(line, size,
+			    " late %.3fms (p99 %.3f)  sample %.3fms (p99 %.3f)  draw %.3fms (p99 %.3f)",
+			    ms(last[0]), ms(wake.percentile(0.99)),
+			    ms(last[1]), ms(sample.percentile(0.99)),
+			    ms(last[2]), ms(draw.percentile(0.99)));
+
+	if (slowest && len > 0 && static_cast<size_t>(len) < size) {
+		len += snprintf(line + len, size - len, "  slowest read %s (%s) %.3fms",
+				slowest->name.c_str(), slowest->driver.c_str(), ms(slowest->last_read));
+	}
+
+	return std::min(static_cast<size_t>(std::max(len, 0)), size - 1);
+}
+
+//
+// one line per measure, in microseconds
+//
+void SelfTiming::write(std::ostream& out) const
+{
+	static const char* hdrs[ncols] = { "ethq timing (us)", "count", "min", "mean", "p50", "p99", "max" };
+
+	char line[out_max];
+	char num[fmt_max];
+
+	auto p = line;
+	for (size_t c = 0; c < ncols; ++c) {
+		if (c) *p++ = ' ';
+		p = fmt_right(p, widths[c], hdrs[c], strlen(hdrs[c]));
+	}
+	*p++ = '\n';
+	out.write(line, p - line);
+
+	auto row = [&](const std::string& label, const Histogram& h) {
+		if (h.count() == 0) return;
+
+		auto p = fmt_right(line, widths[0], label.c_str(), label.size());
+		*p++ = ' ';
+		p = fmt_right(p, widths[1], num, fmt_u64(num, h.count()) - num);
+
+		double stats[] = {
+			double(h.min()), h.mean(),
+			double(h.percentile(0.5)), double(h.percentile(0.99)),
+			double(h.max())
+		};
+
+		for (auto v: stats) {
+			*p++ = ' ';
+			p = fmt_right(p, widths[2], num, fmt_fixed(num, v / 1e3, 1) - num);
+		}
+		*p++ = '\n';
+		out.write(line, p - line);
+	};
+
+	row("wake-up lateness", wake);
+	row("sample all NICs", sample);
+	row("draw or write", draw);
+
+	for (auto& nic: nics) {
+		row(nic.name + " (" + nic.driver + ") read", nic.read);
+		row(nic.name + " (" + nic.driver + ") refresh", nic.refresh);
+	}
+
+	out << std::endl;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "histogram.h"
+#include "render.h"
+
+//
+// ethq's own costs, in ns - how late each tick's wake-up was, how long
+// sampling all the NICs and then drawing or writing the results took,
+// and for each NIC how long reading its counters (i.e. the ethtool
+// ioctls or netlink request) and its whole refresh took
+//
+// the per-NIC times are measured by whichever thread refreshed the NIC
+// and are handed over with its results, so everything here is only
+// touched by the display thread
+//
+class SelfTiming {
+
+private:
+	struct nic_t {
+		std::string		name;
+		std::string		driver;
+		Histogram		read;
+		Histogram		refresh;
+		uint64_t		stamp = 0;
+		uint64_t		last_read = 0;
+	};
+
+	Histogram			wake;
+	Histogram			sample;
+	Histogram			draw;
+	uint64_t			last[3] = { };
+
+	std::vector<nic_t>		nics;
+
+public:
+	void				woke(uint64_t late)	{ wake.add(late); last[0] = late; };
+	void				sampled(uint64_t ns)	{ sample.add(ns); last[1] = ns; };
+	void				drawn(uint64_t ns)	{ draw.add(ns); last[2] = ns; };
+
+	// pick up the times of the NICs' new samples
+	void				update(const ifaces_t& ifaces);
+
+	//
+	// a one-line summary of the latest and the p99 times, and the NIC
+	// that was slowest to read in the latest tick
+	//
+	size_t				format_status(char* line, size_t size) const;
+
+	// the distributions over the run
+	void				write(std::ostream& out) const;
+};
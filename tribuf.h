@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+//
+// lock-free single-producer single-consumer triple buffer
+//
+// the writer fills `back()` and then calls `publish()`, the reader
+// calls `acquire()` to pick up the most recently published buffer
+// and then reads it via `front()` - neither side ever waits for
+// the other, and neither ever sees a partially written buffer
+//
+template<class T>
+class TripleBuffer {
+
+private:
+	static const uint8_t	fresh = 0x4;
+	static const uint8_t	mask = 0x3;
+
+	T			bufs[3];
+	std::atomic<uint8_t>	middle { 1 };
+	uint8_t			w = 0;
+	uint8_t			r = 2;
+
+public:
+	// writer side
+	T& back()			{ return bufs[w]; };
+
+	void publish() {
+		w = middle.exchange(w | fresh, std::memory_order_acq_rel) & mask;
+	}
+
+	// reader side - returns true if a new buffer was picked up
+	bool acquire() {
+		if (!(middle.load(std::memory_order_relaxed) & fresh)) {
+			return false;
+		}
+		r = middle.exchange(r, std::memory_order_acq_rel) & mask;
+		return true;
+	}
+
+	const T& front() const		{ return bufs[r]; };
+
+	// setup only, before any concurrent use
+	template<class F> void each(F fn) {
+		for (auto& buf: bufs) fn(buf);
+	}
+};
@@ -11,6 +11,11 @@
 
 #include <system_error>
 #include <cerrno>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <exception>
+#include <algorithm>
 
 #include "util.h"
 
@@ -18,3 +23,42 @@ void throw_errno(const std::string& what)
 {
 	throw std::system_error(errno, std::system_category(), what);
 }
+
+uint64_t clock_ns(clockid_t clock)
+{
+	timespec ts;
+	clock_gettime(clock, &ts);
+	return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+}
+
+void parallel_for(size_t n, size_t nthreads, const std::function<void(size_t)>& fn)
+{
+	std::atomic<size_t> next { 0 };
+	std::vector<std::exception_ptr> errors(n);
+
+	auto worker = [&]() {
+		for (size_t i; (i = next++) < n; ) {
+			try {
+				fn(i);
+			} catch (...) {
+				errors[i] = std::current_exception();
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (size_t t = 1; t < std::min(nthreads, n); ++t) {
+		threads.emplace_back(worker);
+	}
+	worker();
+
+	for (auto& thread: threads) {
+		thread.join();
+	}
+
+	for (auto& error: errors) {
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+}
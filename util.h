@@ -12,5 +12,18 @@
 #pragma once
 
 #include <string>
+#include <cstdint>
+#include <ctime>
+#include <functional>
 
 extern void throw_errno(const std::string& what);
+
+// the current time on the given clock, in nanoseconds
+extern uint64_t clock_ns(clockid_t clock = CLOCK_MONOTONIC);
+
+//
+// call `fn(i)` for each `i` in [0, n) using up to `nthreads` threads
+// - if any calls throw, the exception from the lowest `i` is rethrown
+// once all of the calls have finished
+//
+extern void parallel_for(size_t n, size_t nthreads, const std::function<void(size_t)>& fn);